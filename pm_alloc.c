@@ -0,0 +1,46 @@
+/* Counted heap allocation for the process discovery engine, see pm_alloc.h.
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "pm_alloc.h"
+
+/* GLOBAL VARIABLES ----------------------------------------------------------*/
+static __thread long nallocs;   // allocations made by this thread
+
+/* Allocate size bytes, as malloc */
+void *mem_alloc(size_t size) {
+    void *ret = malloc(size);
+    nallocs += (ret != NULL);
+    return ret;
+}
+
+/* Allocate n zeroed elements of size bytes, as calloc */
+void *mem_calloc(size_t n, size_t size) {
+    void *ret = calloc(n, size);
+    nallocs += (ret != NULL);
+    return ret;
+}
+
+/* Resize ptr to size bytes, as realloc. A resize counts as an allocation,
+   as it may have to move */
+void *mem_realloc(void *ptr, size_t size) {
+    void *ret = realloc(ptr, size);
+    nallocs += (ret != NULL);
+    return ret;
+}
+
+/* Copy a string into memory of its own, as strdup */
+char *mem_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *ret = (char *)mem_alloc(len);
+    if (ret != NULL) {
+        memcpy(ret, s, len);
+    }
+    return ret;
+}
+
+/* The number of allocations the calling thread has made */
+long mem_count(void) {
+    return nallocs;
+}
@@ -0,0 +1,21 @@
+/* Counted heap allocation for the process discovery engine.
+
+  Every heap allocation of the engine goes through the functions below, which
+  count the allocations made by the calling thread. A discovery reads the
+  count before and after each of its phases to report how many allocations
+  each phase made (pm_mem_stats); the count is per thread so that other
+  discoveries, and the threads decoding a compressed input, do not add to it.
+*/
+#ifndef PM_ALLOC_H
+#define PM_ALLOC_H
+
+#include <stddef.h>
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+void *mem_alloc(size_t size);
+void *mem_calloc(size_t n, size_t size);
+void *mem_realloc(void *ptr, size_t size);
+char *mem_strdup(const char *s);
+long  mem_count(void);
+
+#endif
@@ -0,0 +1,461 @@
+/* On-disk cache of discovery results for the process discovery engine, see
+   pm_cache.h.
+*/
+#define _DEFAULT_SOURCE                 // mkstemp, utimensat, st_mtim, PATH_MAX
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pm_alloc.h"
+#include "pm_cache.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define CACHE_MAGIC 0x31434d50u         // "PMC1"
+#define CACHE_SUFFIX ".pmc"
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct {                // the header of a cache file
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fp_hi;             // the fingerprint of the entry
+    uint64_t fp_lo;
+    uint64_t len;               // the number of payload bytes that follow
+    uint64_t checksum;          // hash_bytes of the payload
+} header_t;
+
+typedef struct {                // a growable output buffer
+    unsigned char *buf;
+    size_t         len;
+    size_t         cpct;
+    int            failed;      // set when out of memory
+} writer_t;
+
+typedef struct {                // a bounds checked input buffer
+    const unsigned char *buf;
+    size_t               len;
+    size_t               pos;
+    int                  failed; // set on a short or malformed payload
+} reader_t;
+
+typedef struct {                // a cache file and its last use
+    char            name[64];
+    struct timespec used;
+} entry_t;
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+static int   entry_path(char *path, const char *dir, fingerprint_t fp);
+static void  put(writer_t *w, const void *data, size_t len);
+static void  put_int(writer_t *w, int64_t x);
+static void  put_actions(writer_t *w, const pm_action_t *a, int n);
+static void  put_longs(writer_t *w, const long *a, long n);
+static void  put_stats(writer_t *w, const pm_stats_t *stats);
+static void  put_result(writer_t *w, const pm_result_t *result);
+static void  get(reader_t *r, void *data, size_t len);
+static long  get_int(reader_t *r, long lo, long hi);
+static pm_action_t *get_actions(reader_t *r, int n);
+static long *get_longs(reader_t *r, long n);
+static void  get_stats(reader_t *r, pm_stats_t *stats);
+static void  get_result(reader_t *r, pm_result_t *result);
+static void  evict(const char *dir, int max_entries);
+static int   cmp_entries(const void *a, const void *b);
+
+/* FNV-1a hash of a block of bytes */
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *c = (const unsigned char *)data;
+    uint64_t h = FNV_OFFSET ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ c[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+/* Scramble the bits of a hash (the splitmix64 finaliser) */
+uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Look an entry up. On a hit, fills whichever of stats and result is not
+   NULL, refreshes the entry for the LRU order and returns 1. A missing or
+   damaged entry returns 0; a damaged one is removed */
+int cache_get(const char *dir, fingerprint_t fp, pm_stats_t *stats,
+              pm_result_t *result) {
+    char path[PATH_MAX];
+    if (!entry_path(path, dir, fp)) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    unsigned char *buf = NULL;
+    header_t header;
+    int ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(header_t);
+    if (ok) {
+        buf = (unsigned char *)mem_alloc(st.st_size);
+        ok = (buf != NULL);
+    }
+    size_t got = 0;
+    while (ok && got < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + got, st.st_size - got);
+        ok = (n > 0);
+        got += ok ? n : 0;
+    }
+    close(fd);
+    if (ok) {
+        memcpy(&header, buf, sizeof(header_t));
+        ok = header.magic == CACHE_MAGIC && header.version == CACHE_VERSION
+             && header.fp_hi == fp.hi && header.fp_lo == fp.lo
+             && header.len == st.st_size - sizeof(header_t)
+             && header.checksum == hash_bytes(buf + sizeof(header_t),
+                                              header.len, 0);
+    }
+
+    pm_stats_t s;
+    pm_result_t res;
+    memset(&s, 0, sizeof(pm_stats_t));
+    memset(&res, 0, sizeof(pm_result_t));
+    if (ok) {
+        reader_t r = {buf + sizeof(header_t), header.len, 0, 0};
+        get_stats(&r, &s);
+        get_result(&r, &res);
+        ok = !r.failed && r.pos == r.len;
+    }
+    free(buf);
+    if (!ok) {
+        pm_stats_release(&s);
+        pm_result_release(&res);
+        unlink(path);
+        return 0;
+    }
+    utimensat(AT_FDCWD, path, NULL, 0);
+    if (stats != NULL) {
+        *stats = s;
+    } else {
+        pm_stats_release(&s);
+    }
+    if (result != NULL) {
+        *result = res;
+    } else {
+        pm_result_release(&res);
+    }
+    return 1;
+}
+
+/* Store an entry, then evict the least recently used entries beyond
+   max_entries */
+pm_status_t cache_put(const char *dir, int max_entries, fingerprint_t fp,
+                      const pm_stats_t *stats, const pm_result_t *result) {
+    char path[PATH_MAX], tmp[PATH_MAX];
+    if (!entry_path(path, dir, fp)
+    || snprintf(tmp, sizeof(tmp), "%s/.pmc.XXXXXX", dir) >= (int)sizeof(tmp)) {
+        return PM_ERR_ARG;
+    }
+    header_t header;
+    writer_t w = {NULL, 0, 0, 0};
+    memset(&header, 0, sizeof(header_t));
+    put(&w, &header, sizeof(header_t));
+    put_stats(&w, stats);
+    put_result(&w, result);
+    if (w.failed) {
+        free(w.buf);
+        return PM_ERR_NOMEM;
+    }
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.fp_hi = fp.hi;
+    header.fp_lo = fp.lo;
+    header.len = w.len - sizeof(header_t);
+    header.checksum = hash_bytes(w.buf + sizeof(header_t), header.len, 0);
+    memcpy(w.buf, &header, sizeof(header_t));
+
+    mkdir(dir, 0755);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(w.buf);
+        return PM_ERR_IO;
+    }
+    size_t done = 0;
+    while (done < w.len) {
+        ssize_t n = write(fd, w.buf + done, w.len - done);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    free(w.buf);
+    if (close(fd) != 0 || done < w.len || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return PM_ERR_IO;
+    }
+    evict(dir, max_entries > 0 ? max_entries : CACHE_DEFAULT_ENTRIES);
+    return PM_OK;
+}
+
+/* the path of the entry of a fingerprint, 0 if it does not fit */
+static int entry_path(char *path, const char *dir, fingerprint_t fp) {
+    int n = snprintf(path, PATH_MAX, "%s/%016llx%016llx" CACHE_SUFFIX, dir,
+                     (unsigned long long)fp.hi, (unsigned long long)fp.lo);
+    return n > 0 && n < PATH_MAX;
+}
+
+/* remove the least recently used entries beyond max_entries */
+static void evict(const char *dir, int max_entries) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+    entry_t *entries = NULL;
+    int n = 0, cpct = 0;
+    struct dirent *de;
+    char path[PATH_MAX];
+    struct stat st;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de -> d_name);
+        if (len < strlen(CACHE_SUFFIX) || len >= sizeof(entries -> name)
+        || strcmp(de -> d_name + len - strlen(CACHE_SUFFIX), CACHE_SUFFIX)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, de -> d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (n == cpct) {
+            cpct = 2 * cpct + 16;
+            entry_t *grown = (entry_t *)mem_realloc(entries,
+                             sizeof(entry_t) * cpct);
+            if (grown == NULL) {
+                break;
+            }
+            entries = grown;
+        }
+        strcpy(entries[n].name, de -> d_name);
+        entries[n].used = st.st_mtim;
+        n++;
+    }
+    closedir(d);
+    if (n > max_entries) {
+        qsort(entries, n, sizeof(entry_t), cmp_entries);
+        for (int i = 0; i < n - max_entries; i++) {
+            snprintf(path, sizeof(path), "%s/%s", dir, entries[i].name);
+            unlink(path);
+        }
+    }
+    free(entries);
+}
+
+/* order cache files from the least to the most recently used */
+static int cmp_entries(const void *a, const void *b) {
+    const struct timespec *x = &((const entry_t *)a) -> used;
+    const struct timespec *y = &((const entry_t *)b) -> used;
+    if (x -> tv_sec != y -> tv_sec) {
+        return (x -> tv_sec < y -> tv_sec) ? -1 : 1;
+    }
+    return (x -> tv_nsec > y -> tv_nsec) - (x -> tv_nsec < y -> tv_nsec);
+}
+
+/* SERIALISATION -------------------------------------------------------------*/
+
+/* append len bytes to the output buffer, growing it as needed */
+static void put(writer_t *w, const void *data, size_t len) {
+    if (w -> failed) {
+        return;
+    }
+    if (w -> len + len > w -> cpct) {
+        size_t cpct = 2 * w -> cpct + len + 256;
+        unsigned char *grown = (unsigned char *)mem_realloc(w -> buf, cpct);
+        if (grown == NULL) {
+            w -> failed = 1;
+            return;
+        }
+        w -> buf = grown;
+        w -> cpct = cpct;
+    }
+    memcpy(w -> buf + w -> len, data, len);
+    w -> len += len;
+}
+
+/* append an integer as 64 bits */
+static void put_int(writer_t *w, int64_t x) {
+    put(w, &x, sizeof(x));
+}
+
+/* append n actions as 32 bits each */
+static void put_actions(writer_t *w, const pm_action_t *a, int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t x = a[i];
+        put(w, &x, sizeof(x));
+    }
+}
+
+/* append n counts as 64 bits each */
+static void put_longs(writer_t *w, const long *a, long n) {
+    for (long i = 0; i < n; i++) {
+        put_int(w, a[i]);
+    }
+}
+
+/* the Stage 0 numbers that follow from the variants; the raw totals, the
+   sample sizes and the filter flag describe the input and are not stored */
+static void put_stats(writer_t *w, const pm_stats_t *stats) {
+    put_int(w, stats -> ndistinct_events);
+    put_int(w, stats -> ndistinct_traces);
+    put_int(w, stats -> nevents);
+    put_int(w, stats -> ntraces);
+    put_int(w, stats -> most_freq);
+    put_int(w, stats -> nmost_freq);
+    for (int i = 0; i < stats -> nmost_freq; i++) {
+        pm_trace_t *t = stats -> most_freq_traces + i;
+        put_int(w, t -> len);
+        put_int(w, t -> freq);
+        put_actions(w, t -> actns, t -> len);
+    }
+    put_actions(w, stats -> actions, stats -> ndistinct_events);
+    put_longs(w, stats -> action_counts, stats -> ndistinct_events);
+}
+
+/* the steps of a model, each with its matrix and the counts after it */
+static void put_result(writer_t *w, const pm_result_t *result) {
+    put_int(w, result -> nsteps);
+    for (int i = 0; i < result -> nsteps; i++) {
+        pm_step_t *step = result -> steps + i;
+        put_int(w, step -> stage);
+        put_int(w, step -> id);
+        put_int(w, step -> type);
+        put_int(w, step -> a);
+        put_int(w, step -> b);
+        put_int(w, step -> removed);
+        put(w, &step -> margin, sizeof(double));
+        put(w, &step -> support, sizeof(double));
+        put_int(w, step -> nacts);
+        put_actions(w, step -> acts, step -> nacts);
+        put_longs(w, step -> sup, (long)step -> nacts * step -> nacts);
+        put_int(w, step -> nafter);
+        put_actions(w, step -> after_acts, step -> nafter);
+        put_longs(w, step -> after_counts, step -> nafter);
+    }
+}
+
+/* read len bytes, zeros once the input is short or failed */
+static void get(reader_t *r, void *data, size_t len) {
+    if (r -> failed || r -> len - r -> pos < len) {
+        r -> failed = 1;
+        memset(data, 0, len);
+        return;
+    }
+    memcpy(data, r -> buf + r -> pos, len);
+    r -> pos += len;
+}
+
+/* read an integer that must lie within [lo, hi] */
+static long get_int(reader_t *r, long lo, long hi) {
+    int64_t x;
+    get(r, &x, sizeof(x));
+    if (x < lo || x > hi) {
+        r -> failed = 1;
+        return lo;
+    }
+    return x;
+}
+
+/* read n actions into an array of their own, NULL on failure */
+static pm_action_t *get_actions(reader_t *r, int n) {
+    if (r -> failed || (r -> len - r -> pos) / sizeof(uint32_t) < (size_t)n) {
+        r -> failed = 1;
+        return NULL;
+    }
+    pm_action_t *ret = (pm_action_t *)mem_alloc(sizeof(pm_action_t) * (n + 1));
+    for (int i = 0; ret != NULL && i < n; i++) {
+        uint32_t x;
+        get(r, &x, sizeof(x));
+        ret[i] = x;
+    }
+    r -> failed |= (ret == NULL);
+    return ret;
+}
+
+/* read n counts into an array of their own, NULL on failure */
+static long *get_longs(reader_t *r, long n) {
+    if (r -> failed || (r -> len - r -> pos) / sizeof(int64_t) < (size_t)n) {
+        r -> failed = 1;
+        return NULL;
+    }
+    long *ret = (long *)mem_alloc(sizeof(long) * (n + 1));
+    for (long i = 0; ret != NULL && i < n; i++) {
+        ret[i] = get_int(r, LONG_MIN, LONG_MAX);
+    }
+    r -> failed |= (ret == NULL);
+    return ret;
+}
+
+/* read the Stage 0 numbers written by put_stats */
+static void get_stats(reader_t *r, pm_stats_t *stats) {
+    stats -> ndistinct_events = get_int(r, 0, INT_MAX);
+    stats -> ndistinct_traces = get_int(r, 0, INT_MAX);
+    stats -> nevents = get_int(r, 0, LONG_MAX);
+    stats -> ntraces = get_int(r, 0, LONG_MAX);
+    stats -> most_freq = get_int(r, 0, LONG_MAX);
+    int nmost_freq = get_int(r, 0, stats -> ndistinct_traces);
+    if (r -> failed) {
+        return;
+    }
+    stats -> most_freq_traces = (pm_trace_t *)mem_calloc(nmost_freq + 1,
+                                sizeof(pm_trace_t));
+    if (stats -> most_freq_traces == NULL) {
+        r -> failed = 1;
+        return;
+    }
+    for (int i = 0; i < nmost_freq && !r -> failed; i++) {
+        pm_trace_t *t = stats -> most_freq_traces + i;
+        t -> len = get_int(r, 0, INT_MAX);
+        t -> freq = get_int(r, 0, LONG_MAX);
+        t -> actns = get_actions(r, t -> len);
+        stats -> nmost_freq += (t -> actns != NULL);
+    }
+    stats -> actions = get_actions(r, stats -> ndistinct_events);
+    stats -> action_counts = get_longs(r, stats -> ndistinct_events);
+}
+
+/* read the steps written by put_result, keeping those read so far on
+   failure so that they can be released */
+static void get_result(reader_t *r, pm_result_t *result) {
+    int nsteps = get_int(r, 0, INT_MAX);
+    if (r -> failed) {
+        return;
+    }
+    result -> steps = (pm_step_t *)mem_calloc(nsteps + 1, sizeof(pm_step_t));
+    if (result -> steps == NULL) {
+        r -> failed = 1;
+        return;
+    }
+    for (int i = 0; i < nsteps && !r -> failed; i++) {
+        pm_step_t *step = result -> steps + i;
+        result -> nsteps++;
+        step -> stage = get_int(r, 1, 2);
+        step -> id = get_int(r, 0, INT_MAX);
+        step -> type = get_int(r, PM_SEQ, PM_CHC);
+        step -> a = get_int(r, 0, UINT_MAX);
+        step -> b = get_int(r, 0, UINT_MAX);
+        step -> removed = get_int(r, 0, LONG_MAX);
+        get(r, &step -> margin, sizeof(double));
+        get(r, &step -> support, sizeof(double));
+        step -> nacts = get_int(r, 0, 1 << 15);
+        step -> acts = get_actions(r, step -> nacts);
+        step -> sup = get_longs(r, (long)step -> nacts * step -> nacts);
+        step -> nafter = get_int(r, 0, 1 << 15);
+        step -> after_acts = get_actions(r, step -> nafter);
+        step -> after_counts = get_longs(r, step -> nafter);
+    }
+}
@@ -0,0 +1,40 @@
+/* On-disk cache of discovery results for the process discovery engine.
+
+  An entry holds the Stage 0 numbers and the discovered model of one log,
+  keyed by a fingerprint of its deduplicated variants and of the discovery
+  parameters. Entries are single files in a cache directory, written to a
+  temporary name and renamed into place, so concurrent writers never expose
+  a partial entry. Each file carries a header with the fingerprint, the
+  payload length and a checksum; an entry that fails any check is removed
+  and treated as a miss. A hit refreshes the file modification time, and
+  when a store leaves more than the allowed number of entries the least
+  recently used ones are removed.
+*/
+#ifndef PM_CACHE_H
+#define PM_CACHE_H
+
+#include <stdint.h>
+
+#include "pm_engine.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define CACHE_VERSION 3                 // bump when the entry layout or the
+                                        //     discovery algorithm changes
+#define CACHE_DEFAULT_ENTRIES 64
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct {                // a 128 bit content fingerprint
+    uint64_t hi;
+    uint64_t lo;
+} fingerprint_t;
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+uint64_t    hash_bytes(const void *data, size_t len, uint64_t seed);
+uint64_t    hash_mix(uint64_t x);
+
+int         cache_get(const char *dir, fingerprint_t fp, pm_stats_t *stats,
+                      pm_result_t *result);
+pm_status_t cache_put(const char *dir, int max_entries, fingerprint_t fp,
+                      const pm_stats_t *stats, const pm_result_t *result);
+
+#endif
@@ -0,0 +1,1959 @@
+/* Process discovery engine, see pm_engine.h.
+
+  The event log and the discovery algorithm below are the ones of the original
+  process_mining.c, reorganised around an engine handle: the input log is kept
+  deduplicated and untouched inside the handle, and every discovery runs on a
+  private copy of it, so the same handle can be queried repeatedly.
+*/
+#define _DEFAULT_SOURCE                 // madvise under -std=c99
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pm_engine.h"
+#include "pm_alloc.h"
+#include "pm_timing.h"
+#include "pm_cache.h"
+#include "pm_input.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define MAX_LOG_CAPACITY 1000           // Initial event log capacity
+#define CHAR_SEPERATOR ','
+#define CHAR_TIMESTAMP '@'              // an action may be followed by @time
+#define MAX_LINE_LENGTH 1000            // initial capacity of the line columns
+#define MAX_ARRAY_DIMENSION 1024
+#define FIRST_ABSTRACTION 256           // the first action that abstracts two
+#define READ_CHUNK 65536                // bytes read at a time from a stream
+#define PI 3.14159265358979323846
+#define ARENA_ALIGN 16                  // alignment of arena allocations
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef pm_action_t action_t;   // an action is identified by an integer
+
+struct pattern {                // a tuple type struct for the seq pantern
+    int a;
+    int b;
+    int type;                   // 0 - SEQ; 1 - CON; 2 - CHC; -1 - ERROR
+    long w;                     // the weight of the pattern
+    long second;                // the weight of the best pattern over any
+                                //     other pair of actions
+};
+
+typedef struct event event_t;   // an event ...
+struct event {                  // ... is composed of ...
+    action_t actn;              // ... an action that triggered it and ...
+    event_t* next;              // ... a pointer to the next event in the trace
+};
+
+typedef struct {                // a trace is a linked list of events
+    event_t* head;              // a pointer to the first event in this trace
+    long     freq;              // the number of times this trace was observed
+    trace_time_t *times;        // its waiting times, NULL if untimed
+} trace_t;
+
+typedef struct {                // an event log is an array of distinct traces
+                                //     sorted lexicographically
+    trace_t* trcs;              // an array of traces
+    int      ndtr;              // the number of distinct traces in this log
+    int      cpct;              // the capacity of this event log as the number
+                                //     of  distinct traces it can hold
+} log_t;
+
+typedef struct {                // the input as it was before filtering
+    long          nevents;      // the number of events read
+    long          ntraces;      // the number of non-empty lines read
+    unsigned char seen[FIRST_ABSTRACTION];  // the actions read
+} raw_t;
+
+typedef struct {                // the filters of an engine, see pm_filter_t
+    long          min_activity_freq;
+    long          min_variant_freq;
+    int           top_k;
+    int           active;       // whether any filter is set
+    unsigned char allow[FIRST_ABSTRACTION]; // include and exclude lists
+} filter_t;
+
+typedef struct {                // approximate discovery, see pm_sample_t
+    long          size;
+    unsigned long seed;
+    int           bootstrap;
+} sample_t;
+
+typedef struct {                // a line of the input
+    const char *p;
+    size_t      len;
+} line_t;
+
+typedef struct chunk chunk_t;   // heap memory an arena had to add
+struct chunk {
+    chunk_t *next;
+};
+
+typedef struct {                // scratch memory reused by every discovery
+    char     *buf;
+    size_t    cpct;             // the size of buf
+    size_t    used;             // the bytes handed out since the last reset
+    chunk_t  *spill;            // allocations that did not fit in buf
+} arena_t;
+
+typedef struct {                // the parameters and memory of one discovery
+    double     scale;           // the weight of a sampled trace, 1 if exact
+    int        bootstrap;       // the number of bootstrap replicates
+    uint64_t   rng;             // the state of the random number generator
+    long      *weights;         // the bootstrap weight of every trace
+    arena_t   *arena;           // where everything below lives
+    int        nrows;           // the most distinct actions at a time
+    action_t  *actions;         // the distinct actions of the current log
+    long     **sup_matrix;      // id-indexed matrices, whose rows ...
+    long     **pd_matrix;
+    long     **w_matrix;
+    long      *rows;            // ... are taken from 3 x nrows rows
+    pm_step_t *steps;           // the steps taken so far
+    int        nsteps;
+} discovery_t;
+
+typedef struct {                // the result of one pass over the input
+    log_t       *log;           // the deduplicated traces
+    raw_t        raw;           // what was read before filtering
+    const unsigned char *keep;  // the actions that pass the filters
+    action_t    *actns;         // column of the actions of the current line
+    double      *ts;            // ... their timestamps, NAN when absent
+    double      *dt;            // ... the waiting time to the next event
+    int         *bkt;           // ... the sketch bucket of that waiting time
+    int          cpct;          // the capacity of the columns
+} ingest_t;
+
+struct pm_engine {
+    pthread_mutex_t lock;       // serialises all calls on this handle
+    log_t          *log;        // the deduplicated input log
+    raw_t           raw;        // the input before filtering
+    filter_t        filter;     // the filters applied to the input
+    unsigned char   keep[FIRST_ABSTRACTION];    // the actions the last load
+                                //     kept, used by pm_add_traces
+    char           *cache_dir;  // where results are cached, NULL for none
+    int             cache_entries;  // the number of cached results kept
+    sample_t        sample;     // the sampling of the input
+    long            input_ntraces;  // the traces of the input when sampled
+    long            sample_ntraces; // ... of them in the log, 0 if exact
+    arena_t         arena;      // scratch memory of discovery, empty while
+                                //     a discovery has it
+    pm_mem_t        mem;        // memory use of discovery
+};
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+static event_t *create_event(action_t action);
+static log_t   *create_log(void);
+static log_t   *clone_log(log_t *log, long min_freq);
+static double   engine_scale(pm_engine_t *engine);
+static long     variant_threshold(pm_engine_t *engine);
+
+static pm_status_t create_ingest(ingest_t *in);
+static pm_status_t line_to_columns(const char *line, size_t len, ingest_t *in,
+                                   int *length);
+static pm_status_t columns_to_event(action_t *actns, int length,
+                                    event_t **event);
+static pm_status_t event_to_log(event_t *event, long freq,
+                                trace_time_t *times, log_t *log);
+static pm_status_t merge_log(log_t *dst, log_t *src);
+static pm_status_t buffer_to_log(const char *buf, size_t len, ingest_t *in);
+static pm_status_t text_to_log(const char *buf, size_t len, ingest_t *in);
+static pm_status_t stream_to_log(const char *buf, size_t len, ingest_t *in);
+static pm_status_t append_text(char **buf, size_t *len, size_t *cpct,
+                               const char *text, size_t n);
+static pm_status_t log_stats(log_t *log, double scale, pm_stats_t *stats);
+static pm_status_t line_to_log(const char *line, size_t len, ingest_t *in);
+static pm_status_t sample_to_log(const char *buf, size_t len, ingest_t *in,
+                                 sample_t *sample, long *ntraces);
+static int next_line(const char **buf, const char *end, line_t *line);
+static fingerprint_t engine_fingerprint(pm_engine_t *engine);
+static void count_actions(const char *buf, size_t len, long *counts);
+static void filter_actions(filter_t *filter, const long *counts,
+                           unsigned char *keep);
+static pm_status_t setup_discovery(log_t *src, long min_freq, log_t *log,
+                                   discovery_t *ctx);
+static pm_status_t discover_stage(log_t *log, int stage, int *num_abstract,
+                                  discovery_t *ctx);
+static pm_status_t export_steps(discovery_t *ctx, pm_result_t *result);
+static struct pattern weigh_pattern(log_t *log, const long *weights,
+                     int stage, action_t *actions, int length,
+                     long **sup_matrix, long **pd_matrix, long **w_matrix);
+static double bootstrap_support(log_t *log, int stage, struct pattern chosen,
+                     action_t *actions, int length, long **sup_matrix,
+                     long **pd_matrix, long **w_matrix, discovery_t *ctx);
+
+static struct pattern get_seq_pattern(long **sup_matrix, long **pd_matrix,
+                               long **w_matrix, action_t *actions, int length);
+static struct pattern get_pattern(long **sup_matrix, long **pd_matrix,
+                     long **w_matrix, action_t *actions, int length, long N);
+
+static void rank_pattern(struct pattern *best, int x, int y, int type,
+                         long w);
+static long max(long x, long y);
+static int  cmp_events(event_t *event1, event_t *event2);
+static int  get_distinct_event(log_t *log, action_t *ret);
+static int  get_most_freq_traces(log_t *log, trace_t **most_freq_trace);
+static int  compute_pd(long x, long y);
+static double parse_time(const char *s, const char *end);
+static void bind_matrix(long **matrix, long *rows, action_t *actions,
+                        int length);
+static size_t discovery_size(int ndtr, long nevents, int nacts);
+static size_t align_size(size_t size);
+static pm_status_t arena_reserve(arena_t *arena, size_t size);
+static void  *arena_alloc(arena_t *arena, size_t size);
+static void   arena_reset(arena_t *arena);
+static void  *copy_array(const void *src, size_t size);
+static long get_num_event(log_t *log, const long *weights);
+static long scale_count(long x, double scale);
+static long poisson(uint64_t *rng, long lambda);
+static double uniform(uint64_t *rng);
+static long get_num_trace(log_t *log);
+static long get_num_action(log_t *log, action_t action);
+static long abstract_pattern(log_t *log, struct pattern pattern,
+                             int abstraction);
+static pm_trace_t *event_to_trace(event_t *e, long freq, pm_trace_t *ret);
+
+static void log_to_sup_matrix(log_t *log, const long *weights, long **matrix);
+static void sup_to_pd_matrix(long **sup_matrix, long **pd_matrix,
+                             action_t *actions, int length);
+static void create_w_matrix(long **w_matrix, long **sup_matrix,
+                            long **pd_matrix, action_t *actions, int length);
+static void free_event(event_t *e);
+static void free_log(log_t *l);
+static void free_ingest(ingest_t *in);
+static void free_arena(arena_t *arena);
+static void free_step(pm_step_t *step);
+
+/* PUBLIC INTERFACE ----------------------------------------------------------*/
+
+/* Create an engine holding an empty log */
+pm_status_t pm_create(pm_engine_t **engine) {
+    if (engine == NULL) {
+        return PM_ERR_ARG;
+    }
+    pm_engine_t *ret = (pm_engine_t *)mem_alloc(sizeof(pm_engine_t));
+    if (ret == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    ret -> log = create_log();
+    if (ret -> log == NULL) {
+        free(ret);
+        return PM_ERR_NOMEM;
+    }
+    memset(&ret -> raw, 0, sizeof(raw_t));
+    memset(&ret -> filter, 0, sizeof(filter_t));
+    memset(ret -> filter.allow, 1, FIRST_ABSTRACTION);
+    memset(ret -> keep, 1, FIRST_ABSTRACTION);
+    ret -> cache_dir = NULL;
+    ret -> cache_entries = 0;
+    memset(&ret -> sample, 0, sizeof(sample_t));
+    ret -> input_ntraces = 0;
+    ret -> sample_ntraces = 0;
+    memset(&ret -> arena, 0, sizeof(arena_t));
+    memset(&ret -> mem, 0, sizeof(pm_mem_t));
+    pthread_mutex_init(&ret -> lock, NULL);
+    *engine = ret;
+    return PM_OK;
+}
+
+/* Free an engine and the log it holds */
+void pm_free(pm_engine_t *engine) {
+    if (engine != NULL) {
+        free_log(engine -> log);
+        free(engine -> cache_dir);
+        free_arena(&engine -> arena);
+        pthread_mutex_destroy(&engine -> lock);
+        free(engine);
+    }
+}
+
+/* Set the filters applied to the input. Actions are filtered while the input
+   is read, so the activity filters apply to logs loaded afterwards (traces
+   added with pm_add_traces keep the actions the last load kept). Variants are
+   filtered whenever the log is queried */
+pm_status_t pm_set_filter(pm_engine_t *engine, const pm_filter_t *filter) {
+    if (engine == NULL || filter == NULL || filter -> min_activity_freq < 0
+    || filter -> min_variant_freq < 0 || filter -> top_k < 0) {
+        return PM_ERR_ARG;
+    }
+    filter_t f;
+    f.min_activity_freq = filter -> min_activity_freq;
+    f.min_variant_freq = filter -> min_variant_freq;
+    f.top_k = filter -> top_k;
+    memset(f.allow, filter -> include == NULL, FIRST_ABSTRACTION);
+    for (const char *c = filter -> include; c != NULL && *c; c++) {
+        f.allow[(unsigned char)*c] = 1;
+    }
+    for (const char *c = filter -> exclude; c != NULL && *c; c++) {
+        f.allow[(unsigned char)*c] = 0;
+    }
+    f.active = f.min_activity_freq > 1 || f.min_variant_freq > 1
+               || f.top_k > 0 || filter -> include != NULL
+               || (filter -> exclude != NULL && *filter -> exclude);
+    pthread_mutex_lock(&engine -> lock);
+    engine -> filter = f;
+    pthread_mutex_unlock(&engine -> lock);
+    return PM_OK;
+}
+
+/* Make logs loaded afterwards a uniform sample of the input, and discovery
+   approximate. A size of 0 reads every trace again */
+pm_status_t pm_set_sample(pm_engine_t *engine, const pm_sample_t *sample) {
+    if (engine == NULL || sample == NULL || sample -> size < 0
+    || sample -> bootstrap < 0) {
+        return PM_ERR_ARG;
+    }
+    pthread_mutex_lock(&engine -> lock);
+    engine -> sample.size = sample -> size;
+    engine -> sample.seed = sample -> seed;
+    engine -> sample.bootstrap = sample -> bootstrap;
+    pthread_mutex_unlock(&engine -> lock);
+    return PM_OK;
+}
+
+/* Replace the log of the engine with the traces in a buffer. Activity
+   frequency filters take a first, counting pass over the buffer so that
+   filtered events are dropped while the traces are built. With a sample
+   size set, only that many traces, drawn uniformly, are parsed. A compressed
+   buffer is parsed while it is decompressed, or decompressed into memory
+   first when the filters or the sampling need a second pass. On failure the
+   previous log is kept */
+pm_status_t pm_load_log(pm_engine_t *engine, const char *buf, size_t len) {
+    if (engine == NULL || (buf == NULL && len > 0)) {
+        return PM_ERR_ARG;
+    }
+    filter_t filter;
+    sample_t sample;
+    unsigned char keep[FIRST_ABSTRACTION];
+    long ntraces = 0;
+    pthread_mutex_lock(&engine -> lock);
+    filter = engine -> filter;
+    sample = engine -> sample;
+    pthread_mutex_unlock(&engine -> lock);
+    int counting = (filter.min_activity_freq > 1 || filter.top_k > 0);
+    char *plain = NULL;
+    if ((counting || sample.size > 0)
+    && input_format(buf, len) != INPUT_PLAIN) {
+        pm_status_t status = input_read_all(buf, len, &plain, &len);
+        if (status != PM_OK) {
+            return status;
+        }
+        buf = plain;
+    }
+    memcpy(keep, filter.allow, FIRST_ABSTRACTION);
+    if (counting) {
+        long counts[FIRST_ABSTRACTION] = {0};
+        count_actions(buf, len, counts);
+        filter_actions(&filter, counts, keep);
+    }
+
+    ingest_t in;
+    pm_status_t status = create_ingest(&in);
+    in.keep = keep;
+    if (status == PM_OK && sample.size > 0) {
+        status = sample_to_log(buf, len, &in, &sample, &ntraces);
+    } else if (status == PM_OK) {
+        status = text_to_log(buf, len, &in);
+    }
+    free(plain);
+    if (status != PM_OK) {
+        free_ingest(&in);
+        return status;
+    }
+    pthread_mutex_lock(&engine -> lock);
+    log_t *old_log = engine -> log;
+    engine -> log = in.log;
+    engine -> raw = in.raw;
+    memcpy(engine -> keep, keep, FIRST_ABSTRACTION);
+    engine -> input_ntraces = ntraces;
+    engine -> sample_ntraces = (ntraces > in.raw.ntraces) ? in.raw.ntraces : 0;
+    pthread_mutex_unlock(&engine -> lock);
+    in.log = old_log;
+    free_ingest(&in);
+    return PM_OK;
+}
+
+/* Replace the log of the engine with the traces in a file. Regular files are
+   mapped into memory, anything else (pipes, devices) is read in chunks */
+pm_status_t pm_load_log_file(pm_engine_t *engine, const char *path) {
+    if (engine == NULL || path == NULL) {
+        return PM_ERR_ARG;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return PM_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return PM_ERR_IO;
+    }
+    pm_status_t status;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            return PM_ERR_IO;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        status = pm_load_log(engine, (const char *)map, st.st_size);
+        munmap(map, st.st_size);
+        return status;
+    }
+
+    char *buf = NULL;
+    size_t len = 0, cpct = 0;
+    ssize_t n;
+    status = PM_OK;
+    while (1) {
+        if (cpct - len < READ_CHUNK) {
+            size_t grown_cpct = cpct ? 2 * cpct : READ_CHUNK;
+            char *grown = (char *)mem_realloc(buf, grown_cpct);
+            if (grown == NULL) {
+                status = PM_ERR_NOMEM;
+                break;
+            }
+            buf = grown;
+            cpct = grown_cpct;
+        }
+        n = read(fd, buf + len, cpct - len);
+        if (n < 0) {
+            status = PM_ERR_IO;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    close(fd);
+    if (status == PM_OK) {
+        status = pm_load_log(engine, buf, len);
+    }
+    free(buf);
+    return status;
+}
+
+/* Add the traces in a buffer to the log of the engine. The buffer is parsed
+   without holding the lock and then merged, with its waiting times, into
+   the log of the engine; only running out of memory while merging leaves
+   part of the traces in the log. A sampled log weighs every trace by the whole
+   input, so no traces can be added to it (PM_ERR_ARG) */
+pm_status_t pm_add_traces(pm_engine_t *engine, const char *buf, size_t len) {
+    if (engine == NULL || (buf == NULL && len > 0)) {
+        return PM_ERR_ARG;
+    }
+    unsigned char keep[FIRST_ABSTRACTION];
+    pthread_mutex_lock(&engine -> lock);
+    int sampled = (engine -> sample_ntraces > 0);
+    memcpy(keep, engine -> keep, FIRST_ABSTRACTION);
+    pthread_mutex_unlock(&engine -> lock);
+    if (sampled) {
+        return PM_ERR_ARG;
+    }
+
+    ingest_t in;
+    pm_status_t status = create_ingest(&in);
+    in.keep = keep;
+    if (status == PM_OK) {
+        status = text_to_log(buf, len, &in);
+    }
+    if (status == PM_OK) {
+        pthread_mutex_lock(&engine -> lock);
+        // a sample may have been loaded meanwhile
+        status = (engine -> sample_ntraces > 0) ? PM_ERR_ARG
+                 : merge_log(engine -> log, in.log);
+        if (status != PM_ERR_ARG) {
+            engine -> raw.nevents += in.raw.nevents;
+            engine -> raw.ntraces += in.raw.ntraces;
+            for (int i = 0; i < FIRST_ABSTRACTION; i++) {
+                engine -> raw.seen[i] |= in.raw.seen[i];
+            }
+        }
+        pthread_mutex_unlock(&engine -> lock);
+    }
+    free_ingest(&in);
+    return status;
+}
+
+/* Compute the Stage 0 numbers of the log of the engine, from the cache when
+   it holds them */
+pm_status_t pm_stats(pm_engine_t *engine, pm_stats_t *stats) {
+    if (engine == NULL || stats == NULL) {
+        return PM_ERR_ARG;
+    }
+    memset(stats, 0, sizeof(pm_stats_t));
+    pthread_mutex_lock(&engine -> lock);
+    log_t *log = engine -> log, *view = NULL;
+    pm_status_t status = PM_OK;
+    if (engine -> cache_dir != NULL && log -> ndtr > 0
+    && cache_get(engine -> cache_dir, engine_fingerprint(engine), stats,
+                 NULL)) {
+        goto raw;
+    }
+    if (variant_threshold(engine) > 1) {
+        log = view = clone_log(log, variant_threshold(engine));
+        if (view == NULL) {
+            status = PM_ERR_NOMEM;
+            goto out;
+        }
+    }
+    if ((status = log_stats(log, engine_scale(engine), stats)) != PM_OK) {
+        goto out;
+    }
+raw:
+    if (engine -> sample_ntraces > 0) {
+        stats -> sample_ntraces = engine -> sample_ntraces;
+        stats -> input_ntraces = engine -> input_ntraces;
+    }
+    stats -> filtered = engine -> filter.active;
+    // a sample only read part of the input: count its lines, scale its events
+    stats -> raw_nevents = scale_count(engine -> raw.nevents,
+                                       engine_scale(engine));
+    stats -> raw_ntraces = (engine -> sample_ntraces > 0)
+                           ? engine -> input_ntraces : engine -> raw.ntraces;
+    for (int i = 0; i < FIRST_ABSTRACTION; i++) {
+        stats -> raw_ndistinct_events += engine -> raw.seen[i];
+    }
+out:
+    pthread_mutex_unlock(&engine -> lock);
+    free_log(view);
+    return status;
+}
+
+/* Discover a process model from the log of the engine. Stage 1 abstracts SEQ
+   patterns over input actions only, Stage 2 abstracts SEQ, CON and CHC
+   patterns until a single action is left. On a sampled log the counts are
+   scaled up to the whole input. With a cache set, a log whose fingerprint
+   is cached skips discovery, and a discovered model is stored together
+   with its Stage 0 numbers */
+pm_status_t pm_discover(pm_engine_t *engine, pm_result_t *result) {
+    if (engine == NULL || result == NULL) {
+        return PM_ERR_ARG;
+    }
+    memset(result, 0, sizeof(pm_result_t));
+    long nallocs = mem_count();
+    char *cache_dir = NULL;
+    int cache_entries = 0;
+    fingerprint_t fp = {0, 0};
+    pthread_mutex_lock(&engine -> lock);
+    if (engine -> cache_dir != NULL && engine -> log -> ndtr > 0) {
+        fp = engine_fingerprint(engine);
+        if (cache_get(engine -> cache_dir, fp, NULL, result)) {
+            pthread_mutex_unlock(&engine -> lock);
+            result -> cached = 1;
+            return PM_OK;
+        }
+        cache_dir = mem_strdup(engine -> cache_dir);
+        cache_entries = engine -> cache_entries;
+    }
+    // take the arena; a concurrent discovery on this handle makes its own
+    arena_t arena = engine -> arena;
+    memset(&engine -> arena, 0, sizeof(arena_t));
+    discovery_t ctx;
+    memset(&ctx, 0, sizeof(discovery_t));
+    ctx.scale = engine_scale(engine);
+    ctx.bootstrap = engine -> sample.bootstrap;
+    ctx.rng = engine -> sample.seed;
+    ctx.arena = &arena;
+    log_t log;
+    pm_status_t status = setup_discovery(engine -> log,
+                         variant_threshold(engine), &log, &ctx);
+    pthread_mutex_unlock(&engine -> lock);
+
+    pm_stats_t stats;
+    memset(&stats, 0, sizeof(pm_stats_t));
+    if (status == PM_OK && cache_dir != NULL) {
+        status = log_stats(&log, ctx.scale, &stats);
+    }
+    int num_abstract = FIRST_ABSTRACTION;
+    long setup_allocs = mem_count() - nallocs;
+    nallocs = mem_count();
+    if (status == PM_OK) {
+        status = discover_stage(&log, 1, &num_abstract, &ctx);
+    }
+    if (status == PM_OK) {
+        status = discover_stage(&log, 2, &num_abstract, &ctx);
+    }
+    long loop_allocs = mem_count() - nallocs;
+    nallocs = mem_count();
+    if (status == PM_OK) {
+        status = export_steps(&ctx, result);
+    }
+    // a cache that cannot be written only costs the next run its hit
+    if (status == PM_OK && cache_dir != NULL) {
+        cache_put(cache_dir, cache_entries, fp, &stats, result);
+    }
+    pm_stats_release(&stats);
+    free(cache_dir);
+    long result_allocs = mem_count() - nallocs;
+    size_t used = arena.used;
+    arena_reset(&arena);
+
+    pthread_mutex_lock(&engine -> lock);
+    if (engine -> arena.cpct < arena.cpct) {
+        free_arena(&engine -> arena);
+        engine -> arena = arena;
+    } else {
+        free_arena(&arena);
+    }
+    if (status != PM_ERR_EMPTY) {
+        engine -> mem.discoveries++;
+        engine -> mem.setup_allocs += setup_allocs;
+        engine -> mem.loop_allocs += loop_allocs;
+        engine -> mem.result_allocs += result_allocs;
+        engine -> mem.arena_used = used;
+    }
+    engine -> mem.arena_bytes = engine -> arena.cpct;
+    pthread_mutex_unlock(&engine -> lock);
+    if (status != PM_OK) {
+        pm_result_release(result);
+    }
+    return status;
+}
+
+/* Report the memory use of discovery on an engine */
+pm_status_t pm_mem_stats(pm_engine_t *engine, pm_mem_t *mem) {
+    if (engine == NULL || mem == NULL) {
+        return PM_ERR_ARG;
+    }
+    pthread_mutex_lock(&engine -> lock);
+    *mem = engine -> mem;
+    pthread_mutex_unlock(&engine -> lock);
+    return PM_OK;
+}
+
+/* Cache discovery results in a directory, keeping at most max_entries of
+   them (0 for the default). A NULL directory disables the cache */
+pm_status_t pm_set_cache(pm_engine_t *engine, const char *dir,
+                         int max_entries) {
+    if (engine == NULL || max_entries < 0) {
+        return PM_ERR_ARG;
+    }
+    char *copy = NULL;
+    if (dir != NULL && (copy = mem_strdup(dir)) == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    pthread_mutex_lock(&engine -> lock);
+    free(engine -> cache_dir);
+    engine -> cache_dir = copy;
+    engine -> cache_entries = max_entries;
+    pthread_mutex_unlock(&engine -> lock);
+    return PM_OK;
+}
+
+/* Summarise the waiting times of every timed DF edge of the log, over the
+   variants that pass the variant filter. The count and sum of a sampled
+   log are scaled up to the whole input like every other count, the mean,
+   extremes and quantiles are those of the sample */
+pm_status_t pm_timing(pm_engine_t *engine, pm_timing_t *timing) {
+    if (engine == NULL || timing == NULL) {
+        return PM_ERR_ARG;
+    }
+    memset(timing, 0, sizeof(pm_timing_t));
+    pthread_mutex_lock(&engine -> lock);
+    edge_time_t *times = NULL;
+    log_t *log = engine -> log;
+    long min_freq = variant_threshold(engine);
+    double scale = engine_scale(engine);
+    pm_status_t status = PM_OK;
+    for (int i = 0; i < log -> ndtr && status == PM_OK; i++) {
+        if ((log -> trcs)[i].freq >= min_freq) {
+            status = add_trace_time(&times, (log -> trcs)[i].times);
+        }
+    }
+    pthread_mutex_unlock(&engine -> lock);
+    int nedges = 0;
+    for (int i = 0; status == PM_OK && times != NULL
+    && i < TIMED_ACTIONS * TIMED_ACTIONS; i++) {
+        nedges += (times[i].count > 0);
+    }
+    if (nedges > 0) {
+        timing -> edges = (pm_edge_time_t *)mem_alloc(sizeof(pm_edge_time_t)
+                          * nedges);
+        if (timing -> edges == NULL) {
+            status = PM_ERR_NOMEM;
+            nedges = 0;
+        }
+    }
+    for (int i = 0; i < TIMED_ACTIONS * TIMED_ACTIONS && nedges > 0; i++) {
+        edge_time_t *edge = times + i;
+        if (edge -> count == 0) {
+            continue;
+        }
+        pm_edge_time_t *ret = timing -> edges + timing -> nedges++;
+        ret -> a = i / TIMED_ACTIONS;
+        ret -> b = i % TIMED_ACTIONS;
+        ret -> count = scale_count(edge -> count, scale);
+        ret -> sum = edge -> sum * scale;
+        ret -> min = edge -> min;
+        ret -> max = edge -> max;
+        ret -> p50 = sketch_quantile(edge, 0.50);
+        ret -> p90 = sketch_quantile(edge, 0.90);
+        ret -> p99 = sketch_quantile(edge, 0.99);
+    }
+    free_timing(times);
+    return status;
+}
+
+/* Free the memory held by the Stage 0 numbers */
+void pm_stats_release(pm_stats_t *stats) {
+    if (stats != NULL) {
+        for (int i = 0; i < stats -> nmost_freq; i++) {
+            free(stats -> most_freq_traces[i].actns);
+        }
+        free(stats -> most_freq_traces);
+        free(stats -> actions);
+        free(stats -> action_counts);
+        memset(stats, 0, sizeof(pm_stats_t));
+    }
+}
+
+/* Free the memory held by a discovered model */
+void pm_result_release(pm_result_t *result) {
+    if (result != NULL) {
+        for (int i = 0; i < result -> nsteps; i++) {
+            free_step(result -> steps + i);
+        }
+        free(result -> steps);
+        memset(result, 0, sizeof(pm_result_t));
+    }
+}
+
+/* Free the memory held by the waiting time summary */
+void pm_timing_release(pm_timing_t *timing) {
+    if (timing != NULL) {
+        free(timing -> edges);
+        memset(timing, 0, sizeof(pm_timing_t));
+    }
+}
+
+/* Describe a status code */
+const char *pm_strerror(pm_status_t status) {
+    switch (status) {
+        case PM_OK:        return "success";
+        case PM_ERR_ARG:   return "invalid argument";
+        case PM_ERR_NOMEM: return "out of memory";
+        case PM_ERR_IO:    return "could not read the input";
+        case PM_ERR_EMPTY: return "the event log is empty";
+        case PM_ERR_FORMAT: return "corrupt or unsupported compressed input";
+    }
+    return "unknown error";
+}
+
+/* LOG -----------------------------------------------------------------------*/
+
+/* Compute the Stage 0 numbers of a log, except the raw totals, counting
+   every trace scale times */
+static pm_status_t log_stats(log_t *log, double scale, pm_stats_t *stats) {
+    pm_status_t status = PM_OK;
+    trace_t *most_freq_traces = NULL;
+    if (log -> ndtr == 0) {
+        return PM_ERR_EMPTY;
+    }
+    action_t actions[MAX_ARRAY_DIMENSION];
+    stats -> ndistinct_events = get_distinct_event(log, actions);
+    stats -> actions = (action_t *)copy_array(actions, sizeof(action_t)
+                       * stats -> ndistinct_events);
+    int nmost_freq = get_most_freq_traces(log, &most_freq_traces);
+    stats -> action_counts = (long *)mem_alloc(sizeof(long)
+                             * (stats -> ndistinct_events + 1));
+    stats -> most_freq_traces = (pm_trace_t *)mem_calloc(nmost_freq + 1,
+                                sizeof(pm_trace_t));
+    if (stats -> actions == NULL || nmost_freq < 0
+    || stats -> action_counts == NULL || stats -> most_freq_traces == NULL) {
+        status = PM_ERR_NOMEM;
+        goto out;
+    }
+    stats -> ndistinct_traces = log -> ndtr;
+    stats -> nevents = scale_count(get_num_event(log, NULL), scale);
+    stats -> ntraces = scale_count(get_num_trace(log), scale);
+    stats -> most_freq = scale_count(most_freq_traces[0].freq, scale);
+    for (int i = 0; i < nmost_freq; i++) {
+        if (event_to_trace(most_freq_traces[i].head, stats -> most_freq,
+                           stats -> most_freq_traces + i) == NULL) {
+            status = PM_ERR_NOMEM;
+            goto out;
+        }
+        stats -> nmost_freq++;
+    }
+    for (int i = 0; i < stats -> ndistinct_events; i++) {
+        stats -> action_counts[i] = scale_count(get_num_action(log,
+                                    stats -> actions[i]), scale);
+    }
+out:
+    free(most_freq_traces);
+    if (status != PM_OK) {
+        pm_stats_release(stats);
+    }
+    return status;
+}
+
+/* The weight of a trace of the log of the engine: the number of input
+   traces per sampled one, 1 when the log is not sampled */
+static double engine_scale(pm_engine_t *engine) {
+    if (engine -> sample_ntraces == 0) {
+        return 1;
+    }
+    return (double)engine -> input_ntraces / engine -> sample_ntraces;
+}
+
+/* The frequency a trace of the log of the engine needs to pass the variant
+   filter, in sampled traces */
+static long variant_threshold(pm_engine_t *engine) {
+    return (long)ceil(engine -> filter.min_variant_freq
+                      / engine_scale(engine));
+}
+
+/* Fingerprint the variants of the log of the engine that pass the variant
+   filter, together with the discovery parameters. Each variant is hashed
+   with its frequency and the hashes are summed, so the fingerprint does not
+   depend on the order of the traces */
+static fingerprint_t engine_fingerprint(pm_engine_t *engine) {
+    log_t *log = engine -> log;
+    uint64_t lo = 0, hi = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        long freq = (log -> trcs)[i].freq;
+        if (freq < variant_threshold(engine)) {
+            continue;
+        }
+        uint64_t h1 = hash_bytes(NULL, 0, 1), h2 = hash_mix(2);
+        for (event_t *e = (log -> trcs)[i].head; e != NULL; e = e -> next) {
+            h1 = hash_bytes(&e -> actn, sizeof(action_t), h1);
+            h2 = hash_mix(h2 ^ e -> actn);
+        }
+        lo += hash_mix(h1 ^ hash_mix(freq));
+        hi += hash_mix(h2 + hash_mix(~freq));
+    }
+    double scale = engine_scale(engine);
+    int64_t params[] = {CACHE_VERSION, engine -> filter.min_variant_freq, 0,
+                        engine -> sample.bootstrap,
+                        (int64_t)engine -> sample.seed};
+    memcpy(params + 2, &scale, sizeof(double));
+    fingerprint_t fp;
+    fp.lo = hash_mix(lo ^ hash_bytes(params, sizeof(params), 1));
+    fp.hi = hash_mix(hi ^ hash_bytes(params, sizeof(params), 2));
+    return fp;
+}
+
+/* Create an event of length 1. Put an action inside an event */
+static event_t *create_event(action_t action) {
+    event_t *ret = (event_t *)mem_alloc(sizeof(event_t));
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret -> actn = action;
+    ret -> next = NULL;
+    return ret;
+}
+
+/* Split an input line into the action and timestamp columns of the
+   ingest: the first character and every character following a separator
+   are actions, and an action may carry a timestamp as in "a@12.5". Actions
+   that do not pass the filters are left out of the columns */
+static pm_status_t line_to_columns(const char *line, size_t len, ingest_t *in,
+                                   int *length) {
+    const char *end = line + len;
+    *length = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (i > 0 && line[i - 1] != CHAR_SEPERATOR) {
+            continue;
+        }
+        if (*length == in -> cpct) {
+            int cpct = 2 * in -> cpct;
+            action_t *actns = (action_t *)mem_realloc(in -> actns,
+                              sizeof(action_t) * cpct);
+            if (actns != NULL) {
+                in -> actns = actns;
+            }
+            double *ts = (double *)mem_realloc(in -> ts, sizeof(double) * cpct);
+            if (ts != NULL) {
+                in -> ts = ts;
+            }
+            double *dt = (double *)mem_realloc(in -> dt, sizeof(double) * cpct);
+            if (dt != NULL) {
+                in -> dt = dt;
+            }
+            int *bkt = (int *)mem_realloc(in -> bkt, sizeof(int) * cpct);
+            if (bkt != NULL) {
+                in -> bkt = bkt;
+            }
+            if (actns == NULL || ts == NULL || dt == NULL || bkt == NULL) {
+                return PM_ERR_NOMEM;
+            }
+            in -> cpct = cpct;
+        }
+        unsigned char actn = line[i];
+        in -> raw.nevents++;
+        in -> raw.seen[actn] = 1;
+        if (!(in -> keep)[actn]) {
+            continue;
+        }
+        (in -> actns)[*length] = actn;
+        (in -> ts)[*length] = NAN;
+        if (i + 1 < len && line[i + 1] == CHAR_TIMESTAMP) {
+            (in -> ts)[*length] = parse_time(line + i + 2, end);
+        }
+        (*length)++;
+    }
+    return PM_OK;
+}
+
+/* Converting an action column into an event */
+static pm_status_t columns_to_event(action_t *actns, int length,
+                                    event_t **event) {
+    event_t **foot = event;
+    *event = NULL;
+    for (int i = 0; i < length; i++) {
+        *foot = create_event(actns[i]);
+        if (*foot == NULL) {
+            free_event(*event);
+            return PM_ERR_NOMEM;
+        }
+        foot = &(*foot) -> next;
+    }
+    return PM_OK;
+}
+
+/* Read a timestamp such as "12", "-3.25" or "1.5e3" that ends at a
+   separator or at the end of the line, NAN if there is none. A timestamp
+   that is not a number up to there, such as "2022-01-01", is NAN too rather
+   than its leading number */
+static double parse_time(const char *s, const char *end) {
+    char num[64];
+    int n = 0;
+    while (s < end && *s != CHAR_SEPERATOR && n < (int)sizeof(num) - 1) {
+        num[n++] = *s++;
+    }
+    num[n] = 0;
+    char *stop;
+    double ret = strtod(num, &stop);
+    if (stop == num || *stop != 0 || (s < end && *s != CHAR_SEPERATOR)) {
+        return NAN;
+    }
+    return ret;
+}
+
+/* Create an empty log to append event */
+static log_t *create_log(void) {
+    log_t *ret = (log_t *)mem_alloc(sizeof(log_t));
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret -> ndtr = 0;
+    ret -> cpct = MAX_LOG_CAPACITY;
+    ret -> trcs = (trace_t *)mem_alloc(sizeof(trace_t) * ret -> cpct);
+    if (ret -> trcs == NULL) {
+        free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+/* Copy the traces of a log seen at least min_freq times */
+static log_t *clone_log(log_t *log, long min_freq) {
+    log_t *ret = (log_t *)mem_alloc(sizeof(log_t));
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret -> ndtr = 0;
+    ret -> cpct = log -> ndtr;
+    ret -> trcs = (trace_t *)mem_alloc(sizeof(trace_t) * (ret -> cpct + 1));
+    if (ret -> trcs == NULL) {
+        free(ret);
+        return NULL;
+    }
+    for (int i = 0; i < log -> ndtr; i++) {
+        if ((log -> trcs)[i].freq < min_freq) {
+            continue;
+        }
+        event_t *head = NULL, **tail = &head;
+        for (event_t *e = (log -> trcs)[i].head; e != NULL; e = e -> next) {
+            *tail = create_event(e -> actn);
+            if (*tail == NULL) {
+                free_event(head);
+                free_log(ret);
+                return NULL;
+            }
+            tail = &(*tail) -> next;
+        }
+        (ret -> trcs)[ret -> ndtr].head = head;
+        (ret -> trcs)[ret -> ndtr].freq = (log -> trcs)[i].freq;
+        (ret -> trcs)[ret -> ndtr].times = NULL;
+        ret -> ndtr++;
+    }
+    return ret;
+}
+
+/* Add event to the log freq times, with the waiting times of those traces,
+   keeping the traces sorted and distinct. The event and its waiting times
+   are owned by the log afterwards */
+static pm_status_t event_to_log(event_t *event, long freq,
+                                trace_time_t *times, log_t *log) {
+    // binary search for the first trace that does not come before the event
+    int lo = 0, hi = log -> ndtr;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cmp_events(event, (log -> trcs)[mid].head) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < log -> ndtr && cmp_events(event, (log -> trcs)[lo].head) == 0) {
+        (log -> trcs)[lo].freq += freq;
+        free_event(event);
+        return merge_trace_time(&(log -> trcs)[lo].times, times);
+    }
+    if (log -> ndtr == log -> cpct) {
+        int cpct = 2 * log -> cpct + 1;
+        trace_t *trcs = (trace_t *)mem_realloc(log -> trcs, sizeof(trace_t) * cpct);
+        if (trcs == NULL) {
+            free_event(event);
+            free_trace_time(times);
+            return PM_ERR_NOMEM;
+        }
+        log -> trcs = trcs;
+        log -> cpct = cpct;
+    }
+    memmove(log -> trcs + lo + 1, log -> trcs + lo,
+            sizeof(trace_t) * (log -> ndtr - lo));
+    (log -> trcs)[lo].head = event;
+    (log -> trcs)[lo].freq = freq;
+    (log -> trcs)[lo].times = times;
+    log -> ndtr++;
+    return PM_OK;
+}
+
+/* Move every trace of src into dst */
+static pm_status_t merge_log(log_t *dst, log_t *src) {
+    for (int i = 0; i < src -> ndtr; i++) {
+        event_t *event = (src -> trcs)[i].head;
+        trace_time_t *times = (src -> trcs)[i].times;
+        (src -> trcs)[i].head = NULL;
+        (src -> trcs)[i].times = NULL;
+        pm_status_t status = event_to_log(event, (src -> trcs)[i].freq, times,
+                                          dst);
+        if (status != PM_OK) {
+            return status;
+        }
+    }
+    return PM_OK;
+}
+
+/* Prepare an empty log and line columns for a pass over the input */
+static pm_status_t create_ingest(ingest_t *in) {
+    in -> log = create_log();
+    memset(&in -> raw, 0, sizeof(raw_t));
+    in -> keep = NULL;
+    in -> cpct = MAX_LINE_LENGTH;
+    in -> actns = (action_t *)mem_alloc(sizeof(action_t) * in -> cpct);
+    in -> ts = (double *)mem_alloc(sizeof(double) * in -> cpct);
+    in -> dt = (double *)mem_alloc(sizeof(double) * in -> cpct);
+    in -> bkt = (int *)mem_alloc(sizeof(int) * in -> cpct);
+    if (in -> log == NULL || in -> actns == NULL || in -> ts == NULL
+    || in -> dt == NULL || in -> bkt == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    return PM_OK;
+}
+
+/* Add every non-empty line of a buffer to the log as a trace, with its
+   waiting times */
+static pm_status_t buffer_to_log(const char *buf, size_t len, ingest_t *in) {
+    const char *end = buf + len;
+    line_t line;
+    while (next_line(&buf, end, &line)) {
+        pm_status_t status = line_to_log(line.p, line.len, in);
+        if (status != PM_OK) {
+            return status;
+        }
+    }
+    return PM_OK;
+}
+
+/* Add every trace of a plain or compressed buffer to the log */
+static pm_status_t text_to_log(const char *buf, size_t len, ingest_t *in) {
+    if (input_format(buf, len) == INPUT_PLAIN) {
+        return buffer_to_log(buf, len, in);
+    }
+    return stream_to_log(buf, len, in);
+}
+
+/* Add every trace of a compressed buffer to the log while it is decompressed
+   on other threads. Each block is parsed up to its last line break, and the
+   rest of the block is carried over to the next one */
+static pm_status_t stream_to_log(const char *buf, size_t len, ingest_t *in) {
+    input_t *input;
+    pm_status_t status = input_open(buf, len, &input);
+    if (status != PM_OK) {
+        return status;
+    }
+    char *carry = NULL;
+    size_t ncarry = 0, cpct = 0;
+    const char *block;
+    size_t nblock;
+    while ((status = input_next(input, &block, &nblock)) == PM_OK
+    && block != NULL) {
+        const char *end = block + nblock;
+        const char *eol = (const char *)memchr(block, '\n', nblock);
+        if (eol != NULL && ncarry > 0) {
+            // the line that started in an earlier block ends here
+            status = append_text(&carry, &ncarry, &cpct, block, eol - block);
+            if (status == PM_OK) {
+                status = buffer_to_log(carry, ncarry, in);
+            }
+            ncarry = 0;
+            block = eol + 1;
+        }
+        const char *last = (eol == NULL) ? block : end;
+        while (last > block && last[-1] != '\n') {
+            last--;
+        }
+        if (status == PM_OK && last > block) {
+            status = buffer_to_log(block, last - block, in);
+        }
+        if (status == PM_OK) {
+            status = append_text(&carry, &ncarry, &cpct, last, end - last);
+        }
+        if (status != PM_OK) {
+            break;
+        }
+    }
+    if (status == PM_OK && ncarry > 0) {
+        status = buffer_to_log(carry, ncarry, in);
+    }
+    input_close(input);
+    free(carry);
+    return status;
+}
+
+/* Append n bytes of text to a growable buffer */
+static pm_status_t append_text(char **buf, size_t *len, size_t *cpct,
+                               const char *text, size_t n) {
+    if (*cpct - *len < n) {
+        size_t grown_cpct = *cpct ? 2 * *cpct : MAX_LINE_LENGTH;
+        while (grown_cpct - *len < n) {
+            grown_cpct *= 2;
+        }
+        char *grown = (char *)mem_realloc(*buf, grown_cpct);
+        if (grown == NULL) {
+            return PM_ERR_NOMEM;
+        }
+        *buf = grown;
+        *cpct = grown_cpct;
+    }
+    memcpy(*buf + *len, text, n);
+    *len += n;
+    return PM_OK;
+}
+
+/* Add a uniform sample of sample -> size lines of a buffer to the log
+   (reservoir sampling), and count the lines of the buffer in ntraces */
+static pm_status_t sample_to_log(const char *buf, size_t len, ingest_t *in,
+                                 sample_t *sample, long *ntraces) {
+    const char *end = buf + len;
+    uint64_t rng = sample -> seed;
+    line_t line, *reservoir = NULL;
+    long cpct = 0;
+    *ntraces = 0;
+    while (next_line(&buf, end, &line)) {
+        long slot = *ntraces;
+        if (slot >= sample -> size) {
+            slot = (long)(uniform(&rng) * (*ntraces + 1));
+        }
+        if (slot == cpct && cpct < sample -> size) {
+            long grown_cpct = (2 * cpct + 64 < sample -> size)
+                              ? 2 * cpct + 64 : sample -> size;
+            line_t *grown = (line_t *)mem_realloc(reservoir,
+                            sizeof(line_t) * grown_cpct);
+            if (grown == NULL) {
+                free(reservoir);
+                return PM_ERR_NOMEM;
+            }
+            reservoir = grown;
+            cpct = grown_cpct;
+        }
+        if (slot < sample -> size) {
+            reservoir[slot] = line;
+        }
+        (*ntraces)++;
+    }
+    long nsampled = (*ntraces < sample -> size) ? *ntraces : sample -> size;
+    for (long i = 0; i < nsampled; i++) {
+        pm_status_t status = line_to_log(reservoir[i].p, reservoir[i].len, in);
+        if (status != PM_OK) {
+            free(reservoir);
+            return status;
+        }
+    }
+    free(reservoir);
+    return PM_OK;
+}
+
+/* Find the next non-empty line of a buffer, without its line break. Returns
+   0 at the end of the buffer */
+static int next_line(const char **buf, const char *end, line_t *line) {
+    while (*buf < end) {
+        const char *eol = (const char *)memchr(*buf, '\n', end - *buf);
+        if (eol == NULL) {
+            eol = end;
+        }
+        line -> p = *buf;
+        line -> len = eol - *buf;
+        if (line -> len > 0 && (line -> p)[line -> len - 1] == '\r') {
+            line -> len--;
+        }
+        *buf = eol + 1;
+        if (line -> len > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Add an input line to the log as a trace, with its waiting times */
+static pm_status_t line_to_log(const char *line, size_t len, ingest_t *in) {
+    event_t *event;
+    trace_time_t *times = NULL;
+    int length;
+    pm_status_t status = line_to_columns(line, len, in, &length);
+    in -> raw.ntraces++;
+    if (status != PM_OK || length == 0) {
+        return status;
+    }
+    status = time_trace(&times, in -> actns, in -> ts, in -> dt, in -> bkt,
+                        length);
+    if (status == PM_OK) {
+        status = columns_to_event(in -> actns, length, &event);
+    }
+    if (status == PM_OK) {
+        return event_to_log(event, 1, times, in -> log);
+    }
+    free_trace_time(times);
+    return status;
+}
+
+/* First pass over a buffer: count the occurrences of every action */
+static void count_actions(const char *buf, size_t len, long *counts) {
+    const unsigned char *c = (const unsigned char *)buf;
+    const unsigned char *end = c + len;
+    int at_action = 1;
+    for (; c < end; c++) {
+        if (at_action && *c != '\n') {
+            counts[*c]++;
+        }
+        at_action = (*c == CHAR_SEPERATOR || *c == '\n');
+    }
+}
+
+/* Narrow the actions allowed by the include and exclude lists down to those
+   seen at least min_activity_freq times, then to the top_k most frequent */
+static void filter_actions(filter_t *filter, const long *counts,
+                           unsigned char *keep) {
+    for (int i = 0; i < FIRST_ABSTRACTION; i++) {
+        keep[i] = (filter -> allow)[i] && counts[i] > 0
+                  && counts[i] >= filter -> min_activity_freq;
+    }
+    if (filter -> top_k <= 0) {
+        return;
+    }
+    int kept = 0;
+    for (int i = 0; i < FIRST_ABSTRACTION; i++) {
+        kept += keep[i];
+    }
+    // drop the least frequent action, the greater one on ties
+    while (kept > filter -> top_k) {
+        int drop = -1;
+        for (int i = 0; i < FIRST_ABSTRACTION; i++) {
+            if (keep[i] && (drop < 0 || counts[i] <= counts[drop])) {
+                drop = i;
+            }
+        }
+        keep[drop] = 0;
+        kept--;
+    }
+}
+
+/* compare two event in ASCII code*/
+static int cmp_events(event_t *event1, event_t *event2) {
+    while ((event1 != NULL) && (event2 != NULL)) {
+        // if event1 < event 2 (ASCII)
+        if (event1 -> actn > event2 -> actn) {
+            return -1;
+        }
+        // if event 2 > event 1 (ASCII)
+        if (event1 -> actn < event2 -> actn) {
+            return 1;
+        }
+        // if event 1 == event 2 (ASCII), move it to the next event
+        event1 = event1 -> next;
+        event2 = event2 -> next;
+    }
+    if ((event1 == NULL) && (event2 != NULL)) {
+        return -1;
+    }
+    if ((event1 != NULL) && (event2 == NULL)) {
+        return 1;
+    }
+    return 0;
+}
+
+/* get the distinct actions of the log in ascending order into ret, which
+   must have room for all of them, returns their number */
+static int get_distinct_event(log_t *log, action_t *ret) {
+    unsigned char seen[MAX_ARRAY_DIMENSION] = {0};
+    int length = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        for (event_t *e = (log -> trcs)[i].head; e != NULL; e = e -> next) {
+            seen[e -> actn] = 1;
+        }
+    }
+    for (int i = 0; i < MAX_ARRAY_DIMENSION; i++) {
+        if (seen[i]) {
+            ret[length++] = i;
+        }
+    }
+    return length;
+}
+
+/* get the total number of event, counting trace i weights[i] times when
+   weights are given */
+static long get_num_event(log_t *log, const long *weights) {
+    long count_event = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        long c = 0;
+        event_t *current = (log -> trcs + i) -> head;
+        while (current != NULL) {
+            c++;
+            current = current -> next;
+        }
+        count_event += c * (weights ? weights[i] : (log -> trcs + i) -> freq);
+    }
+    return count_event;
+}
+
+/* get the total number of traces */
+static long get_num_trace(log_t *log) {
+    long count_trace = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        count_trace += (log -> trcs)[i].freq;
+    }
+    return count_trace;
+}
+
+/* get the most frequent traces, returns their number or -1 if out of
+   memory */
+static int get_most_freq_traces(log_t *log, trace_t **most_freq_trace) {
+    (*most_freq_trace) = (trace_t *)mem_alloc(sizeof(trace_t) * log -> ndtr);
+    if ((*most_freq_trace) == NULL) {
+        return -1;
+    }
+    int length = 0;
+    long most_freq = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        if (most_freq == (log -> trcs)[i].freq) {
+            length += 1;
+            (*most_freq_trace)[length - 1] = (log -> trcs)[i];
+        }
+        if (most_freq < (log -> trcs)[i].freq) {
+            length = 1;
+            (*most_freq_trace)[0] = (log -> trcs)[i];
+            most_freq = (log -> trcs)[i].freq;
+        }
+    }
+    return length;
+}
+
+/* get the total number of actions */
+static long get_num_action(log_t *log, action_t action) {
+    long count_action = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        long c = 0;
+        event_t *current = (log -> trcs + i) -> head;
+        while (current != NULL) {
+            if (current -> actn == action) {
+                c++;
+            }
+            current = current -> next;
+        }
+        count_action += (c * ((log -> trcs + i) -> freq));
+    }
+    return count_action;
+}
+
+/* copy an event into an array of actions */
+static pm_trace_t *event_to_trace(event_t *e, long freq, pm_trace_t *ret) {
+    int len = 0;
+    for (event_t *cur = e; cur != NULL; cur = cur -> next) {
+        len++;
+    }
+    ret -> actns = (pm_action_t *)mem_alloc(sizeof(pm_action_t) * (len + 1));
+    if (ret -> actns == NULL) {
+        return NULL;
+    }
+    ret -> len = 0;
+    for (event_t *cur = e; cur != NULL; cur = cur -> next) {
+        (ret -> actns)[ret -> len++] = cur -> actn;
+    }
+    ret -> freq = freq;
+    return ret;
+}
+
+/* DISCOVERY -----------------------------------------------------------------*/
+
+/* Set a discovery up, under the engine lock: size the arena from the
+   traces of src seen at least min_freq times, their events and distinct
+   actions, copy those traces into it as log, and lay out the bootstrap
+   weights, the matrices and the steps. Every step merges two actions into
+   one, so there are fewer steps than distinct actions */
+static pm_status_t setup_discovery(log_t *src, long min_freq, log_t *log,
+                                   discovery_t *ctx) {
+    unsigned char seen[MAX_ARRAY_DIMENSION] = {0};
+    int ndtr = 0, nacts = 0;
+    long nevents = 0;
+    for (int i = 0; i < src -> ndtr; i++) {
+        if ((src -> trcs)[i].freq < min_freq) {
+            continue;
+        }
+        for (event_t *e = (src -> trcs)[i].head; e != NULL; e = e -> next) {
+            nacts += !seen[e -> actn];
+            seen[e -> actn] = 1;
+            nevents++;
+        }
+        ndtr++;
+    }
+    if (ndtr == 0) {
+        return PM_ERR_EMPTY;
+    }
+    pm_status_t status = arena_reserve(ctx -> arena,
+                                       discovery_size(ndtr, nevents, nacts));
+    if (status != PM_OK) {
+        return status;
+    }
+
+    arena_t *arena = ctx -> arena;
+    log -> trcs = (trace_t *)arena_alloc(arena, sizeof(trace_t) * ndtr);
+    event_t *events = (event_t *)arena_alloc(arena, sizeof(event_t) * nevents);
+    ctx -> weights = (long *)arena_alloc(arena, sizeof(long) * ndtr);
+    ctx -> nrows = nacts;
+    ctx -> actions = (action_t *)arena_alloc(arena, sizeof(action_t) * nacts);
+    ctx -> sup_matrix = (long **)arena_alloc(arena, sizeof(long *)
+                        * MAX_ARRAY_DIMENSION);
+    ctx -> pd_matrix = (long **)arena_alloc(arena, sizeof(long *)
+                       * MAX_ARRAY_DIMENSION);
+    ctx -> w_matrix = (long **)arena_alloc(arena, sizeof(long *)
+                      * MAX_ARRAY_DIMENSION);
+    ctx -> rows = (long *)arena_alloc(arena, sizeof(long) * 3 * nacts
+                  * MAX_ARRAY_DIMENSION);
+    ctx -> steps = (pm_step_t *)arena_alloc(arena, sizeof(pm_step_t) * nacts);
+    ctx -> nsteps = 0;
+    if (log -> trcs == NULL || events == NULL || ctx -> weights == NULL
+    || ctx -> actions == NULL || ctx -> sup_matrix == NULL
+    || ctx -> pd_matrix == NULL || ctx -> w_matrix == NULL
+    || ctx -> rows == NULL || ctx -> steps == NULL) {
+        return PM_ERR_NOMEM;
+    }
+
+    log -> ndtr = 0;
+    log -> cpct = ndtr;
+    for (int i = 0; i < src -> ndtr; i++) {
+        if ((src -> trcs)[i].freq < min_freq) {
+            continue;
+        }
+        event_t **tail = &(log -> trcs)[log -> ndtr].head;
+        for (event_t *e = (src -> trcs)[i].head; e != NULL; e = e -> next) {
+            events -> actn = e -> actn;
+            *tail = events;
+            tail = &(events++) -> next;
+        }
+        *tail = NULL;
+        (log -> trcs)[log -> ndtr].freq = (src -> trcs)[i].freq;
+        (log -> trcs)[log -> ndtr].times = NULL;
+        log -> ndtr++;
+    }
+    return PM_OK;
+}
+
+/* Run one stage of discovery on the log, recording every abstraction step.
+   Everything it needs was laid out in the arena by setup_discovery */
+static pm_status_t discover_stage(log_t *log, int stage, int *num_abstract,
+                                  discovery_t *ctx) {
+    while (1) {
+        action_t *actions = ctx -> actions;
+        int length = get_distinct_event(log, actions);
+        long **sup_matrix = ctx -> sup_matrix;
+        long **pd_matrix = ctx -> pd_matrix;
+        long **w_matrix = ctx -> w_matrix;
+        bind_matrix(sup_matrix, ctx -> rows, actions, length);
+        bind_matrix(pd_matrix, ctx -> rows + ctx -> nrows
+                    * MAX_ARRAY_DIMENSION, actions, length);
+        bind_matrix(w_matrix, ctx -> rows + 2 * ctx -> nrows
+                    * MAX_ARRAY_DIMENSION, actions, length);
+        struct pattern pattern = weigh_pattern(log, NULL, stage,
+                                 actions, length, sup_matrix, pd_matrix,
+                                 w_matrix);
+        if (pattern.a < 0) {
+            return PM_OK;
+        }
+
+        pm_step_t *step = ctx -> steps + ctx -> nsteps;
+        memset(step, 0, sizeof(pm_step_t));
+        ctx -> nsteps++;
+        step -> stage = stage;
+        step -> id = *num_abstract;
+        step -> type = (stage == 1) ? PM_SEQ : pattern.type;
+        step -> a = pattern.a;
+        step -> b = pattern.b;
+        step -> margin = (double)(pattern.w - pattern.second) / pattern.w;
+        step -> support = -1;
+        step -> nacts = length;
+        step -> acts = (action_t *)arena_alloc(ctx -> arena,
+                       sizeof(action_t) * length);
+        step -> sup = (long *)arena_alloc(ctx -> arena, sizeof(long)
+                      * length * length);
+        if (step -> acts == NULL || step -> sup == NULL) {
+            return PM_ERR_NOMEM;
+        }
+        memcpy(step -> acts, actions, sizeof(action_t) * length);
+        for (int i = 0; i < length; i++) {
+            for (int j = 0; j < length; j++) {
+                (step -> sup)[i * length + j] = scale_count(
+                    sup_matrix[actions[i]][actions[j]], ctx -> scale);
+            }
+        }
+        if (ctx -> bootstrap > 0) {
+            step -> support = bootstrap_support(log, stage, pattern,
+                              actions, length, sup_matrix, pd_matrix,
+                              w_matrix, ctx);
+        }
+
+        step -> removed = scale_count(abstract_pattern(log, pattern,
+                                      *num_abstract), ctx -> scale);
+        step -> nafter = get_distinct_event(log, actions);
+        step -> after_acts = (action_t *)arena_alloc(ctx -> arena,
+                             sizeof(action_t) * step -> nafter);
+        step -> after_counts = (long *)arena_alloc(ctx -> arena,
+                               sizeof(long) * step -> nafter);
+        if (step -> after_acts == NULL || step -> after_counts == NULL) {
+            return PM_ERR_NOMEM;
+        }
+        memcpy(step -> after_acts, actions, sizeof(action_t)
+               * step -> nafter);
+        for (int i = 0; i < step -> nafter; i++) {
+            (step -> after_counts)[i] = scale_count(get_num_action(log,
+                                        (step -> after_acts)[i]), ctx -> scale);
+        }
+        (*num_abstract)++;
+    }
+}
+
+/* Copy the steps of a discovery out of the arena into the result */
+static pm_status_t export_steps(discovery_t *ctx, pm_result_t *result) {
+    result -> steps = (pm_step_t *)mem_alloc(sizeof(pm_step_t)
+                      * (ctx -> nsteps + 1));
+    if (result -> steps == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    for (int i = 0; i < ctx -> nsteps; i++) {
+        pm_step_t *src = ctx -> steps + i, *dst = result -> steps + i;
+        *dst = *src;
+        dst -> acts = (action_t *)copy_array(src -> acts,
+                      sizeof(action_t) * src -> nacts);
+        dst -> sup = (long *)copy_array(src -> sup,
+                     sizeof(long) * src -> nacts * src -> nacts);
+        dst -> after_acts = (action_t *)copy_array(src -> after_acts,
+                            sizeof(action_t) * src -> nafter);
+        dst -> after_counts = (long *)copy_array(src -> after_counts,
+                              sizeof(long) * src -> nafter);
+        result -> nsteps++;
+        if (dst -> acts == NULL || dst -> sup == NULL
+        || dst -> after_acts == NULL || dst -> after_counts == NULL) {
+            return PM_ERR_NOMEM;
+        }
+    }
+    return PM_OK;
+}
+
+/* Build the sup, pd and w matrices of a log whose trace i is counted
+   weights[i] (or its frequency) times, and get the pattern of a stage from
+   them. A sampled log is weighed unscaled: pd and the ranking of the weights
+   do not change with scale, and the CHC threshold uses the sample's own
+   number of events */
+static struct pattern weigh_pattern(log_t *log, const long *weights,
+                     int stage, action_t *actions, int length,
+                     long **sup_matrix, long **pd_matrix, long **w_matrix) {
+    for (int i = 0; i < length; i++) {
+        memset(sup_matrix[actions[i]], 0, sizeof(long) * MAX_ARRAY_DIMENSION);
+    }
+    log_to_sup_matrix(log, weights, sup_matrix);
+    sup_to_pd_matrix(sup_matrix, pd_matrix, actions, length);
+    create_w_matrix(w_matrix, sup_matrix, pd_matrix, actions, length);
+    if (stage == 1) {
+        return get_seq_pattern(sup_matrix, pd_matrix, w_matrix,
+                               actions, length);
+    }
+    return get_pattern(sup_matrix, pd_matrix, w_matrix, actions, length,
+                       get_num_event(log, weights));
+}
+
+/* the share of bootstrap replicates of the log that choose the same pattern:
+   every replicate weighs each trace with a Poisson draw of its frequency */
+static double bootstrap_support(log_t *log, int stage, struct pattern chosen,
+                     action_t *actions, int length, long **sup_matrix,
+                     long **pd_matrix, long **w_matrix, discovery_t *ctx) {
+    int agree = 0;
+    for (int r = 0; r < ctx -> bootstrap; r++) {
+        for (int i = 0; i < log -> ndtr; i++) {
+            (ctx -> weights)[i] = poisson(&ctx -> rng, (log -> trcs)[i].freq);
+        }
+        struct pattern p = weigh_pattern(log, ctx -> weights,
+                           stage, actions, length, sup_matrix, pd_matrix,
+                           w_matrix);
+        agree += p.type == chosen.type
+                 && ((p.a == chosen.a && p.b == chosen.b)
+                 || (p.a == chosen.b && p.b == chosen.a));
+    }
+    return (double)agree / ctx -> bootstrap;
+}
+
+/* get the SEQ pattern from the matrix*/
+static struct pattern get_seq_pattern(long **sup_matrix, long **pd_matrix,
+long **w_matrix, action_t *actions, int length) {
+    struct pattern ret = {-1, -1, 0, 0, 0};
+    for (int i = 0; i < length; i++) {
+        action_t x = actions[i];
+        for (int j = 0; j < length; j++) {
+            action_t y = actions[j];
+            if (x == y) {
+                continue;
+            }
+            if (pd_matrix[x][y] <= 70) {
+                continue;
+            }
+            if (x >= FIRST_ABSTRACTION || y >= FIRST_ABSTRACTION) {
+                continue;
+            }
+            rank_pattern(&ret, x, y, 0, w_matrix[x][y]);
+        }
+    }
+    return ret;
+}
+
+/* get the pattern(SEQ, CON or CHC) from the matrix */
+static struct pattern get_pattern(long **sup_matrix, long **pd_matrix,
+long **w_matrix, action_t *actions, int length, long N) {
+    struct pattern ret = {-1, -1, -1, 0, 0};
+    for (int i = 0; i < length; i++) {
+        action_t x = actions[i];
+        for (int j = 0; j < length; j++) {
+            int pat = -1;
+            long w = 0;
+            action_t y = actions[j];
+            if (x == y) {
+                continue;
+            }
+            if (max(sup_matrix[x][y], sup_matrix[y][x]) <= N/100) {
+                pat = 2;
+                w = N * 100;
+            }
+            else if (pd_matrix[x][y] < 30){
+                pat = 1;
+                w =  w_matrix[x][y];
+                if (!(x >= FIRST_ABSTRACTION || y >= FIRST_ABSTRACTION)) {
+                    w = w * 100;
+                }
+            }
+            else if (pd_matrix[x][y] > 70) {
+                pat = 0;
+                w =  w_matrix[x][y];
+                if (!(x >= FIRST_ABSTRACTION || y >= FIRST_ABSTRACTION)) {
+                    w = w * 100;
+                }
+            }
+            if (pat == -1){
+                continue;
+            }
+            rank_pattern(&ret, x, y, pat, w);
+        }
+    }
+    return ret;
+}
+
+/* keep the heavier of the best pattern so far and pattern type over (x, y),
+   and the weight of the runner-up over a different pair of actions. A CHC
+   pair that ties the best CHC weight is not a runner-up, as every CHC pair
+   weighs N * 100; a SEQ or CON tie is, and gives a zero margin */
+static void rank_pattern(struct pattern *best, int x, int y, int type,
+                         long w) {
+    int same = (x == best -> a && y == best -> b)
+               || (x == best -> b && y == best -> a)
+               || (type == PM_CHC && best -> type == PM_CHC
+                   && w == best -> w);
+    if (w > best -> w) {
+        if (!same) {
+            best -> second = best -> w;
+        }
+        best -> a = x;
+        best -> b = y;
+        best -> type = type;
+        best -> w = w;
+    } else if (!same && w > best -> second) {
+        best -> second = w;
+    }
+}
+
+/* abstract the given pattern in to a number */
+static long abstract_pattern(log_t *log, struct pattern pattern,
+                             int abstraction) {
+    long num_removed = 0;
+    for (int i = 0; i < log -> ndtr; i++) {
+        event_t *current = (log -> trcs + i) -> head;
+        while (current != NULL) {
+            if ((current -> actn == pattern.a)
+            || (current -> actn == pattern.b)) {
+                current -> actn = abstraction;
+            }
+            current = current -> next;
+        }
+    }
+    for (int i = 0; i < log -> ndtr; i++) {
+        event_t *current = (log -> trcs + i) -> head;
+        while (current -> next != NULL) {
+            if ((current -> actn == abstraction)
+            && (current -> next -> actn == abstraction)) {
+                // the node belongs to the arena of the discovery
+                current -> next = current -> next -> next;
+                num_removed += (log -> trcs + i) -> freq;
+            } else{
+                current = current -> next;
+            }
+        }
+    }
+    return num_removed;
+}
+
+/* point the rows of an id-indexed matrix for the given actions at
+   consecutive rows of MAX_ARRAY_DIMENSION ints */
+static void bind_matrix(long **matrix, long *rows, action_t *actions,
+                        int length) {
+    for (int i = 0; i < length; i++) {
+        matrix[actions[i]] = rows + (size_t)i * MAX_ARRAY_DIMENSION;
+    }
+}
+
+/* create the sup matrix for a given log */
+static void log_to_sup_matrix(log_t *log, const long *weights, long **matrix) {
+    for (int i = 0; i < log -> ndtr; i++) {
+        event_t *current = (log -> trcs + i) -> head;
+        long freq = weights ? weights[i] : (log -> trcs + i) -> freq;
+        while (current != NULL) {
+            if (current -> next != NULL) {
+                matrix[current -> actn][(current -> next) -> actn] += freq;
+            }
+            current = current -> next;
+        }
+    }
+}
+
+/* transform the sup matrix into pd matrix */
+static void sup_to_pd_matrix(long **sup_matrix, long **pd_matrix,
+action_t *actions, int length) {
+    for (int i = 0; i < length; i++) {
+        action_t x = actions[i];
+        for (int j = 0; j < length; j++) {
+            action_t y = actions[j];
+            if ((x != y) && (sup_matrix[x][y] > sup_matrix[y][x])) {
+                pd_matrix[x][y] = compute_pd(sup_matrix[x][y],
+                sup_matrix[y][x]);
+            }
+            else {
+                pd_matrix[x][y] = 0;
+            }
+        }
+    }
+}
+
+/* create the weight matrix from sup and pd matrix */
+static void create_w_matrix(long **w_matrix, long **sup_matrix,
+long **pd_matrix, action_t *actions, int length) {
+    for (int i = 0; i < length; i++) {
+        action_t x = actions[i];
+        for (int j = 0; j < length; j++) {
+            action_t y = actions[j];
+            w_matrix[x][y] = labs(50 - pd_matrix[x][y])
+            * max(sup_matrix[x][y], sup_matrix[y][x]);
+        }
+    }
+}
+
+/* scale a count of the sampled log up to the whole input */
+static long scale_count(long x, double scale) {
+    return (scale == 1) ? x : llround(x * scale);
+}
+
+/* a uniform random number in [0, 1) */
+static double uniform(uint64_t *rng) {
+    *rng += 0x9e3779b97f4a7c15ull;
+    return (hash_mix(*rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* a Poisson distributed random number of mean lambda; large means use the
+   normal approximation */
+static long poisson(uint64_t *rng, long lambda) {
+    if (lambda < 30) {
+        double limit = exp(-(double)lambda), p = uniform(rng);
+        long k = 0;
+        while (p > limit) {
+            p *= uniform(rng);
+            k++;
+        }
+        return k;
+    }
+    double u1 = uniform(rng), u2 = uniform(rng);
+    double z = sqrt(-2 * log(1 - u1)) * cos(2 * PI * u2);
+    long k = llround(lambda + sqrt((double)lambda) * z);
+    return (k < 0) ? 0 : k;
+}
+
+/* calculate the pd value for a pair of action */
+static int compute_pd(long x, long y) {
+    return (100 * labs(x - y))/(max(x, y));
+}
+
+/* find the maximum number out of two number */
+static long max(long x, long y) {
+    if (x > y) {
+        return x;
+    }
+    return y;
+}
+
+/* MEMORY --------------------------------------------------------------------*/
+
+/* The arena bytes setup_discovery and discover_stage take for a log of ndtr
+   traces, nevents events and nacts distinct actions: the log, the bootstrap
+   weights, the distinct actions, the matrices and the steps, the step over
+   k actions keeping k actions, k x k counts and k - 1 actions after it */
+static size_t discovery_size(int ndtr, long nevents, int nacts) {
+    size_t size = align_size(sizeof(trace_t) * ndtr)
+                + align_size(sizeof(event_t) * nevents)
+                + align_size(sizeof(long) * ndtr)
+                + align_size(sizeof(action_t) * nacts)
+                + 3 * align_size(sizeof(long *) * MAX_ARRAY_DIMENSION)
+                + align_size(sizeof(long) * 3 * nacts * MAX_ARRAY_DIMENSION)
+                + align_size(sizeof(pm_step_t) * nacts);
+    for (size_t k = 2; k <= (size_t)nacts; k++) {
+        size += align_size(sizeof(action_t) * k)
+              + align_size(sizeof(long) * k * k)
+              + align_size(sizeof(action_t) * (k - 1))
+              + align_size(sizeof(long) * (k - 1));
+    }
+    return size;
+}
+
+/* round a size up to the alignment of arena allocations */
+static size_t align_size(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/* Empty an arena and make it hold at least size bytes */
+static pm_status_t arena_reserve(arena_t *arena, size_t size) {
+    arena_reset(arena);
+    if (arena -> cpct >= size) {
+        return PM_OK;
+    }
+    free(arena -> buf);
+    arena -> buf = (char *)mem_alloc(size);
+    arena -> cpct = (arena -> buf == NULL) ? 0 : size;
+    return (arena -> buf == NULL) ? PM_ERR_NOMEM : PM_OK;
+}
+
+/* Take size bytes from an arena. When it is full the bytes come from the
+   heap, so running out of arena is slow but never wrong */
+static void *arena_alloc(arena_t *arena, size_t size) {
+    size = align_size(size);
+    if (arena -> cpct - arena -> used >= size) {
+        void *ret = arena -> buf + arena -> used;
+        arena -> used += size;
+        return ret;
+    }
+    chunk_t *chunk = (chunk_t *)mem_alloc(ARENA_ALIGN + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk -> next = arena -> spill;
+    arena -> spill = chunk;
+    return (char *)chunk + ARENA_ALIGN;
+}
+
+/* Give back everything taken from an arena, keeping its buffer */
+static void arena_reset(arena_t *arena) {
+    while (arena -> spill != NULL) {
+        chunk_t *next = arena -> spill -> next;
+        free(arena -> spill);
+        arena -> spill = next;
+    }
+    arena -> used = 0;
+}
+
+/* copy an array into memory of its own, returns NULL if out of memory */
+static void *copy_array(const void *src, size_t size) {
+    void *ret = mem_alloc(size + 1);
+    if (ret != NULL && size > 0) {
+        memcpy(ret, src, size);
+    }
+    return ret;
+}
+
+/* FREE ----------------------------------------------------------------------*/
+
+/* Free the memory allocated for the event */
+static void free_event(event_t *e) {
+    while (e != NULL) {
+        event_t *next = e -> next;
+        free(e);
+        e = next;
+    }
+}
+
+/* Free the memory allocated for the log */
+static void free_log(log_t *l) {
+    if (l != NULL) {
+        for (int i = 0; i < l -> ndtr; i++) {
+            free_event((l -> trcs)[i].head);
+            free_trace_time((l -> trcs)[i].times);
+        }
+        free(l -> trcs);
+        free(l);
+    }
+}
+
+/* Free the log and columns of a pass over the input */
+static void free_ingest(ingest_t *in) {
+    free_log(in -> log);
+    free(in -> actns);
+    free(in -> ts);
+    free(in -> dt);
+    free(in -> bkt);
+}
+
+/* Free the memory of an arena */
+static void free_arena(arena_t *arena) {
+    arena_reset(arena);
+    free(arena -> buf);
+    memset(arena, 0, sizeof(arena_t));
+}
+
+/* free memory held by one discovery step */
+static void free_step(pm_step_t *step) {
+    free(step -> acts);
+    free(step -> sup);
+    free(step -> after_acts);
+    free(step -> after_counts);
+}
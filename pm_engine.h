@@ -0,0 +1,195 @@
+/* Process discovery engine.
+
+  Library interface to the event log and discovery logic that used to live
+  entirely in main() of process_mining.c. An engine handle owns one
+  deduplicated event log; the log can be loaded from a buffer or a file,
+  extended with more traces, summarised (Stage 0) and queried for a process
+  model (Stages 1 and 2) any number of times without re-reading the input.
+
+  Every function returns a pm_status_t instead of asserting or printing.
+  Calls on the same handle are serialised by a per-handle lock, so one handle
+  may be shared between threads; separate handles are fully independent.
+
+  Input format: one trace per line, actions separated by CHAR_SEPERATOR,
+  each action being a single character, e.g. "a,b,c,d". An action may be
+  followed by '@' and a numeric timestamp, e.g. "a@0,b@2.5,c@7"; the waiting
+  time of every handover between two timestamped events is then aggregated
+  per directly follows edge and reported by pm_timing. A timestamp must be
+  a number up to the next separator or the end of the line; anything else,
+  such as a date, leaves its event untimed rather than being read in part. The input may also be
+  gzip or zstd compressed (see pm_input.h); it is then decompressed on
+  separate threads while it is parsed.
+
+  Filters set with pm_set_filter drop rare or unwanted actions while the
+  input is read, before traces are deduplicated, and rare variants before
+  the log is summarised, discovered or its waiting times are reported; a
+  trace left without actions is dropped.
+
+  With a cache directory set by pm_set_cache, the Stage 0 numbers and the
+  model of a log are stored on disk under a fingerprint of its distinct
+  traces, their frequencies and the discovery parameters, and a later
+  engine that loads a log with the same fingerprint reads them back instead
+  of running discovery.
+
+  With a sample size set by pm_set_sample, a load keeps a uniform sample of
+  the traces of the input (reservoir sampling) and every count reported is
+  scaled up to the whole input, which gives a quick approximate model of a
+  large log. Each step reports how clearly its pattern won (margin) and,
+  with bootstrap replicates, how often a resampled log picks it (support);
+  a larger sample refines the model. Traces cannot be added to a sampled
+  log.
+
+  Discovery works in scratch memory owned by the engine (an arena), sized
+  once per discovery from the number of distinct actions and events of the
+  log and kept for the next one; the abstraction loop itself makes no heap
+  allocations, which pm_mem_stats reports.
+*/
+#ifndef PM_ENGINE_H
+#define PM_ENGINE_H
+
+#include <stddef.h>
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef unsigned int pm_action_t;       // actions < 256 are input characters,
+                                        //     256 and above are abstractions
+
+typedef struct pm_engine pm_engine_t;   // opaque engine handle
+
+typedef enum {
+    PM_OK        =  0,
+    PM_ERR_ARG   = -1,                  // invalid argument
+    PM_ERR_NOMEM = -2,                  // out of memory
+    PM_ERR_IO    = -3,                  // could not read the input
+    PM_ERR_EMPTY = -4,                  // the log holds no events
+    PM_ERR_FORMAT = -5                  // corrupt or unsupported compressed
+                                        //     input
+} pm_status_t;
+
+typedef enum {                          // the kind of a discovered pattern
+    PM_SEQ = 0,
+    PM_CON = 1,
+    PM_CHC = 2
+} pm_pattern_type_t;
+
+typedef struct {                        // a distinct trace of the log
+    pm_action_t *actns;                 // the actions of this trace, in order
+    int          len;                   // the number of actions in this trace
+    long         freq;                  // the number of times it was observed
+} pm_trace_t;
+
+typedef struct {                        // filters applied to the input
+    long         min_activity_freq;     // drop actions seen fewer times
+    long         min_variant_freq;      // drop traces seen fewer times
+    int          top_k;                 // keep the k most frequent actions
+                                        //     only, 0 keeps all of them
+    const char  *include;               // if not NULL, keep these actions only
+    const char  *exclude;               // if not NULL, drop these actions
+} pm_filter_t;
+
+typedef struct {                        // approximate discovery on a sample
+    long          size;                 // traces to sample, 0 reads them all
+    unsigned long seed;                 // seed of the sampling and bootstrap
+    int           bootstrap;            // bootstrap replicates per step,
+                                        //     0 for none
+} pm_sample_t;
+
+typedef struct {                        // the Stage 0 numbers
+    int          filtered;              // whether any filter is set
+    int          raw_ndistinct_events;  // distinct actions before filtering
+    long         raw_nevents;           // events before filtering
+    long         raw_ntraces;           // traces before filtering
+    long         sample_ntraces;        // traces sampled, 0 if not sampled
+    long         input_ntraces;         // ... out of this many in the input
+    int          ndistinct_events;      // number of distinct actions
+    int          ndistinct_traces;      // number of distinct traces
+    long         nevents;               // total number of events
+    long         ntraces;               // total number of traces
+    long         most_freq;             // frequency of the most frequent trace
+    int          nmost_freq;            // number of traces with that frequency
+    pm_trace_t  *most_freq_traces;      // ... in log order
+    pm_action_t *actions;               // distinct actions, ascending
+    long        *action_counts;         // occurrences of each distinct action
+} pm_stats_t;
+
+typedef struct {                        // one abstraction step of discovery
+    int          stage;                 // 1 or 2
+    int          id;                    // the action introduced by this step
+    int          type;                  // a pm_pattern_type_t
+    pm_action_t  a;                     // the two actions that were ...
+    pm_action_t  b;                     // ... abstracted into id
+    long         removed;               // number of events removed
+    double       margin;                // (w - w2) / w, where w is the weight
+                                        //     of the pattern and w2 that of
+                                        //     the best pattern over any other
+                                        //     pair of actions
+    double       support;               // share of bootstrap replicates that
+                                        //     choose the same pattern, -1
+                                        //     without bootstrap
+    int          nacts;                 // distinct actions before the step
+    pm_action_t *acts;                  // ... ascending
+    long        *sup;                   // nacts x nacts directly follows counts
+                                        //     before the step, row-major
+    int          nafter;                // distinct actions after the step
+    pm_action_t *after_acts;            // ... ascending
+    long        *after_counts;          // occurrences of each of them
+} pm_step_t;
+
+typedef struct {                        // waiting times of one DF edge a -> b
+    pm_action_t  a;
+    pm_action_t  b;
+    long         count;                 // number of timed handovers, and ...
+    double       sum;                   // ... their total waiting time, both
+                                        //     scaled up when sampled
+    double       min;                   // shortest waiting time
+    double       max;                   // longest waiting time
+    double       p50;                   // estimated median waiting time
+    double       p90;                   // estimated 90th percentile
+    double       p99;                   // estimated 99th percentile
+} pm_edge_time_t;
+
+typedef struct {                        // the waiting times of the log
+    int             nedges;             // number of timed DF edges
+    pm_edge_time_t *edges;              // ... ordered by a, then b
+} pm_timing_t;
+
+typedef struct {                        // the discovered model
+    int          nsteps;                // number of abstraction steps
+    pm_step_t   *steps;                 // ... in the order they were applied
+    int          cached;                // whether it was read from the cache
+} pm_result_t;
+
+typedef struct {                        // memory use of discovery
+    long         discoveries;           // discoveries run, cache hits aside
+    long         setup_allocs;          // heap allocations made to set them up
+    long         loop_allocs;           // heap allocations made by their
+                                        //     abstraction loops, 0 unless the
+                                        //     arena was too small
+    long         result_allocs;         // heap allocations made to return and
+                                        //     cache their results
+    size_t       arena_bytes;           // the size of the arena
+    size_t       arena_used;            // bytes of it the last discovery used
+} pm_mem_t;
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+pm_status_t pm_create(pm_engine_t **engine);
+void        pm_free(pm_engine_t *engine);
+
+pm_status_t pm_set_filter(pm_engine_t *engine, const pm_filter_t *filter);
+pm_status_t pm_set_cache(pm_engine_t *engine, const char *dir,
+                         int max_entries);
+pm_status_t pm_set_sample(pm_engine_t *engine, const pm_sample_t *sample);
+pm_status_t pm_load_log(pm_engine_t *engine, const char *buf, size_t len);
+pm_status_t pm_load_log_file(pm_engine_t *engine, const char *path);
+pm_status_t pm_add_traces(pm_engine_t *engine, const char *buf, size_t len);
+
+pm_status_t pm_stats(pm_engine_t *engine, pm_stats_t *stats);
+pm_status_t pm_discover(pm_engine_t *engine, pm_result_t *result);
+pm_status_t pm_timing(pm_engine_t *engine, pm_timing_t *timing);
+pm_status_t pm_mem_stats(pm_engine_t *engine, pm_mem_t *mem);
+
+void        pm_stats_release(pm_stats_t *stats);
+void        pm_result_release(pm_result_t *result);
+void        pm_timing_release(pm_timing_t *timing);
+const char *pm_strerror(pm_status_t status);
+
+#endif
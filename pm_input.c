@@ -0,0 +1,465 @@
+/* Compressed input for the process discovery engine, see pm_input.h.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef PM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef PM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "pm_alloc.h"
+#include "pm_input.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define GZIP_MAGIC "\x1f\x8b"
+#define ZSTD_MAGIC "\x28\xb5\x2f\xfd"
+#define ZLIB_WINDOW (15 + 32)           // accept a zlib or a gzip header
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct {                // a decompressed block
+    char   *buf;
+    size_t  len;
+    size_t  cpct;
+    int     ready;              // whether the block is decoded and unread
+} slot_t;
+
+struct input {
+    const unsigned char *src;   // the compressed input
+    size_t          srclen;
+    input_format_t  format;
+    pthread_mutex_t lock;       // guards the fields below down to stop
+    pthread_cond_t  cond;       // signalled when a block is decoded or freed
+    slot_t          slots[INPUT_SLOTS]; // block i goes to slot i % INPUT_SLOTS
+    long            next;       // the next block to decode
+    long            consumed;   // the number of blocks the parser is done with
+    int             held;       // whether the parser holds block consumed
+    long            nblocks;    // the number of blocks, -1 until known
+    pm_status_t     status;     // the first decoding error
+    int             stop;       // set when the input is closed early
+    int             nthreads;
+    pthread_t       threads[INPUT_THREADS];
+    size_t         *frames;     // the offsets of the zstd frames and of the
+                                //     end, NULL when decoding a single stream
+    size_t          pos;        // the input consumed by the stream
+#ifdef PM_HAVE_ZLIB
+    z_stream        z;
+    int             z_init;     // whether z needs inflateEnd
+#endif
+#ifdef PM_HAVE_ZSTD
+    ZSTD_DStream   *zds;
+    size_t          zret;       // the last hint of ZSTD_decompressStream,
+                                //     0 at the end of a frame
+#endif
+};
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+static void       *decode_blocks(void *arg);
+static pm_status_t decode_block(input_t *input, long seq, slot_t *slot,
+                                void *dctx, int *last);
+static int         grow_slot(slot_t *slot, size_t cpct);
+#ifdef PM_HAVE_ZLIB
+static pm_status_t inflate_block(input_t *input, slot_t *slot, int *last);
+#endif
+#ifdef PM_HAVE_ZSTD
+static pm_status_t find_frames(input_t *input);
+static pm_status_t zstd_block(input_t *input, slot_t *slot, int *last);
+static pm_status_t zstd_frame(input_t *input, long seq, slot_t *slot,
+                              ZSTD_DCtx *dctx);
+#endif
+
+/* INPUT ---------------------------------------------------------------------*/
+
+/* Recognise a compressed input by its magic bytes */
+input_format_t input_format(const char *buf, size_t len) {
+    if (len >= 2 && memcmp(buf, GZIP_MAGIC, 2) == 0) {
+        return INPUT_GZIP;
+    }
+    if (len >= 4 && memcmp(buf, ZSTD_MAGIC, 4) == 0) {
+        return INPUT_ZSTD;
+    }
+    return INPUT_PLAIN;
+}
+
+/* Start decompressing a gzip or zstd buffer, which must stay valid until the
+   input is closed. Several zstd frames are decoded on up to one thread per
+   processor, anything else on one thread */
+pm_status_t input_open(const char *buf, size_t len, input_t **input) {
+    input_format_t format = input_format(buf, len);
+    if (format == INPUT_PLAIN) {
+        return PM_ERR_ARG;
+    }
+    input_t *ret = (input_t *)mem_calloc(1, sizeof(input_t));
+    if (ret == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    ret -> src = (const unsigned char *)buf;
+    ret -> srclen = len;
+    ret -> format = format;
+    ret -> nblocks = -1;
+    ret -> status = PM_ERR_FORMAT;
+    ret -> nthreads = 1;
+    pthread_mutex_init(&ret -> lock, NULL);
+    pthread_cond_init(&ret -> cond, NULL);
+#ifdef PM_HAVE_ZLIB
+    if (format == INPUT_GZIP) {
+        ret -> status = (inflateInit2(&ret -> z, ZLIB_WINDOW) == Z_OK)
+                        ? PM_OK : PM_ERR_NOMEM;
+        ret -> z_init = (ret -> status == PM_OK);
+    }
+#endif
+#ifdef PM_HAVE_ZSTD
+    if (format == INPUT_ZSTD) {
+        ret -> status = find_frames(ret);
+    }
+    if (ret -> status == PM_OK && ret -> frames != NULL) {
+        long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        ret -> nthreads = (ret -> nblocks < INPUT_THREADS)
+                          ? ret -> nblocks : INPUT_THREADS;
+        if (ncpus > 0 && ncpus < ret -> nthreads) {
+            ret -> nthreads = ncpus;
+        }
+    } else if (ret -> status == PM_OK && format == INPUT_ZSTD) {
+        ret -> zds = ZSTD_createDStream();
+        ret -> zret = 1;
+        if (ret -> zds == NULL || ZSTD_isError(ZSTD_initDStream(ret -> zds))) {
+            ret -> status = PM_ERR_NOMEM;
+        }
+    }
+#endif
+    for (int i = 0; ret -> status == PM_OK && i < ret -> nthreads; i++) {
+        if (pthread_create(ret -> threads + i, NULL, decode_blocks, ret) != 0) {
+            if (i == 0) {
+                ret -> status = PM_ERR_NOMEM;
+            }
+            ret -> nthreads = i;
+        }
+    }
+    if (ret -> status != PM_OK) {
+        pm_status_t status = ret -> status;
+        ret -> nthreads = 0;
+        input_close(ret);
+        return status;
+    }
+    *input = ret;
+    return PM_OK;
+}
+
+/* Hand the next decompressed block to the parser, in input order, waiting
+   for it to be decoded. The previous block is given back to the decoders.
+   block is set to NULL at the end of the input */
+pm_status_t input_next(input_t *input, const char **block, size_t *len) {
+    pthread_mutex_lock(&input -> lock);
+    if (input -> held) {
+        (input -> slots)[input -> consumed % INPUT_SLOTS].ready = 0;
+        input -> consumed++;
+        input -> held = 0;
+        pthread_cond_broadcast(&input -> cond);
+    }
+    slot_t *slot = input -> slots + input -> consumed % INPUT_SLOTS;
+    while (input -> status == PM_OK && !slot -> ready
+    && (input -> nblocks < 0 || input -> consumed < input -> nblocks)) {
+        pthread_cond_wait(&input -> cond, &input -> lock);
+    }
+    pm_status_t status = input -> status;
+    *block = NULL;
+    *len = 0;
+    if (status == PM_OK && slot -> ready) {
+        *block = slot -> buf;
+        *len = slot -> len;
+        input -> held = 1;
+    }
+    pthread_mutex_unlock(&input -> lock);
+    return status;
+}
+
+/* Stop the decoders and free the input */
+void input_close(input_t *input) {
+    if (input == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&input -> lock);
+    input -> stop = 1;
+    pthread_cond_broadcast(&input -> cond);
+    pthread_mutex_unlock(&input -> lock);
+    for (int i = 0; i < input -> nthreads; i++) {
+        pthread_join(input -> threads[i], NULL);
+    }
+    for (int i = 0; i < INPUT_SLOTS; i++) {
+        free(input -> slots[i].buf);
+    }
+#ifdef PM_HAVE_ZLIB
+    if (input -> z_init) {
+        inflateEnd(&input -> z);
+    }
+#endif
+#ifdef PM_HAVE_ZSTD
+    ZSTD_freeDStream(input -> zds);
+#endif
+    free(input -> frames);
+    pthread_cond_destroy(&input -> cond);
+    pthread_mutex_destroy(&input -> lock);
+    free(input);
+}
+
+/* Decompress a whole gzip or zstd buffer into memory */
+pm_status_t input_read_all(const char *buf, size_t len, char **ret,
+                           size_t *ret_len) {
+    input_t *input;
+    pm_status_t status = input_open(buf, len, &input);
+    if (status != PM_OK) {
+        return status;
+    }
+    char *all = NULL;
+    size_t nall = 0, cpct = 0;
+    const char *block;
+    size_t nblock;
+    while ((status = input_next(input, &block, &nblock)) == PM_OK
+    && block != NULL) {
+        if (cpct - nall < nblock) {
+            size_t grown_cpct = cpct ? 2 * cpct : INPUT_BLOCK;
+            while (grown_cpct - nall < nblock) {
+                grown_cpct *= 2;
+            }
+            char *grown = (char *)mem_realloc(all, grown_cpct);
+            if (grown == NULL) {
+                status = PM_ERR_NOMEM;
+                break;
+            }
+            all = grown;
+            cpct = grown_cpct;
+        }
+        memcpy(all + nall, block, nblock);
+        nall += nblock;
+    }
+    input_close(input);
+    if (status != PM_OK) {
+        free(all);
+        return status;
+    }
+    *ret = all;
+    *ret_len = nall;
+    return PM_OK;
+}
+
+/* DECODING ------------------------------------------------------------------*/
+
+/* Decoder thread: claim the next block while it is at most INPUT_SLOTS ahead
+   of the parser, decode it into its slot and publish it */
+static void *decode_blocks(void *arg) {
+    input_t *input = (input_t *)arg;
+    void *dctx = NULL;
+#ifdef PM_HAVE_ZSTD
+    if (input -> frames != NULL) {
+        dctx = ZSTD_createDCtx();
+    }
+#endif
+    pthread_mutex_lock(&input -> lock);
+    while (1) {
+        while (!input -> stop && input -> status == PM_OK
+        && (input -> nblocks < 0 || input -> next < input -> nblocks)
+        && input -> next >= input -> consumed + INPUT_SLOTS) {
+            pthread_cond_wait(&input -> cond, &input -> lock);
+        }
+        if (input -> stop || input -> status != PM_OK
+        || (input -> nblocks >= 0 && input -> next >= input -> nblocks)) {
+            break;
+        }
+        long seq = (input -> next)++;
+        slot_t *slot = input -> slots + seq % INPUT_SLOTS;
+        pthread_mutex_unlock(&input -> lock);
+
+        int last = 0;
+        pm_status_t status = decode_block(input, seq, slot, dctx, &last);
+
+        pthread_mutex_lock(&input -> lock);
+        if (status != PM_OK && input -> status == PM_OK) {
+            input -> status = status;
+        }
+        if (last) {
+            input -> nblocks = seq + 1;
+        }
+        slot -> ready = (status == PM_OK);
+        pthread_cond_broadcast(&input -> cond);
+    }
+    pthread_mutex_unlock(&input -> lock);
+#ifdef PM_HAVE_ZSTD
+    ZSTD_freeDCtx((ZSTD_DCtx *)dctx);
+#endif
+    return NULL;
+}
+
+/* Decode block seq of the input into a slot. A stream is decoded one block
+   at a time by a single thread and sets last at its end; a zstd frame is a
+   block of its own */
+static pm_status_t decode_block(input_t *input, long seq, slot_t *slot,
+                                void *dctx, int *last) {
+#ifdef PM_HAVE_ZSTD
+    if (input -> frames != NULL) {
+        return zstd_frame(input, seq, slot, (ZSTD_DCtx *)dctx);
+    }
+#endif
+    if (!grow_slot(slot, INPUT_BLOCK)) {
+        return PM_ERR_NOMEM;
+    }
+#ifdef PM_HAVE_ZLIB
+    if (input -> format == INPUT_GZIP) {
+        return inflate_block(input, slot, last);
+    }
+#endif
+#ifdef PM_HAVE_ZSTD
+    if (input -> format == INPUT_ZSTD) {
+        return zstd_block(input, slot, last);
+    }
+#endif
+    return PM_ERR_FORMAT;
+}
+
+/* Make room for at least cpct bytes in a slot, returns 0 if out of memory */
+static int grow_slot(slot_t *slot, size_t cpct) {
+    if (slot -> cpct >= cpct) {
+        return 1;
+    }
+    char *grown = (char *)mem_realloc(slot -> buf, cpct);
+    if (grown == NULL) {
+        return 0;
+    }
+    slot -> buf = grown;
+    slot -> cpct = cpct;
+    return 1;
+}
+
+#ifdef PM_HAVE_ZLIB
+/* Inflate the next INPUT_BLOCK bytes of a gzip stream. Concatenated gzip
+   members are read as one stream */
+static pm_status_t inflate_block(input_t *input, slot_t *slot, int *last) {
+    z_stream *z = &input -> z;
+    z -> next_out = (Bytef *)slot -> buf;
+    z -> avail_out = INPUT_BLOCK;
+    while (z -> avail_out > 0) {
+        if (z -> avail_in == 0) {
+            size_t n = input -> srclen - input -> pos;
+            z -> next_in = (Bytef *)(input -> src + input -> pos);
+            z -> avail_in = (n > UINT_MAX) ? UINT_MAX : (uInt)n;
+            input -> pos += z -> avail_in;
+        }
+        int ret = inflate(z, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            if (z -> avail_in == 0 && input -> pos == input -> srclen) {
+                *last = 1;
+                break;
+            }
+            inflateReset(z);
+        } else if (ret == Z_MEM_ERROR) {
+            return PM_ERR_NOMEM;
+        } else if (ret != Z_OK) {
+            return PM_ERR_FORMAT;       // corrupt or truncated
+        }
+    }
+    slot -> len = INPUT_BLOCK - z -> avail_out;
+    return PM_OK;
+}
+#endif
+
+#ifdef PM_HAVE_ZSTD
+/* Locate the zstd frames of the input. Only an input of several frames gets
+   a frame table, and then one block per frame */
+static pm_status_t find_frames(input_t *input) {
+    long nframes = 0;
+    size_t pos = 0;
+    while (pos < input -> srclen) {
+        size_t n = ZSTD_findFrameCompressedSize(input -> src + pos,
+                                                input -> srclen - pos);
+        if (ZSTD_isError(n)) {
+            return PM_ERR_FORMAT;
+        }
+        pos += n;
+        nframes++;
+    }
+    if (nframes < 2) {
+        return PM_OK;
+    }
+    input -> frames = (size_t *)mem_alloc(sizeof(size_t) * (nframes + 1));
+    if (input -> frames == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    pos = 0;
+    for (long i = 0; i < nframes; i++) {
+        input -> frames[i] = pos;
+        pos += ZSTD_findFrameCompressedSize(input -> src + pos,
+                                            input -> srclen - pos);
+    }
+    input -> frames[nframes] = pos;
+    input -> nblocks = nframes;
+    return PM_OK;
+}
+
+/* Decompress the next INPUT_BLOCK bytes of a zstd stream */
+static pm_status_t zstd_block(input_t *input, slot_t *slot, int *last) {
+    ZSTD_outBuffer out = {slot -> buf, INPUT_BLOCK, 0};
+    ZSTD_inBuffer in = {input -> src, input -> srclen, input -> pos};
+    while (out.pos < out.size) {
+        if (in.pos == in.size && input -> zret == 0) {
+            *last = 1;
+            break;
+        }
+        size_t out_pos = out.pos, in_pos = in.pos;
+        size_t ret = ZSTD_decompressStream(input -> zds, &out, &in);
+        if (ZSTD_isError(ret)
+        || (ret != 0 && out.pos == out_pos && in.pos == in_pos)) {
+            return PM_ERR_FORMAT;       // corrupt or truncated
+        }
+        input -> zret = ret;
+    }
+    input -> pos = in.pos;
+    slot -> len = out.pos;
+    return PM_OK;
+}
+
+/* Decompress frame seq of the input, which may be larger than a block */
+static pm_status_t zstd_frame(input_t *input, long seq, slot_t *slot,
+                              ZSTD_DCtx *dctx) {
+    if (dctx == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    const unsigned char *src = input -> src + input -> frames[seq];
+    size_t len = input -> frames[seq + 1] - input -> frames[seq];
+    unsigned long long size = ZSTD_getFrameContentSize(src, len);
+    if (size == ZSTD_CONTENTSIZE_ERROR) {
+        return PM_ERR_FORMAT;
+    }
+    size_t cpct = INPUT_BLOCK;
+    if (size != ZSTD_CONTENTSIZE_UNKNOWN && size < SIZE_MAX) {
+        cpct = size + 1;        // a spare byte: a full buffer means more output
+    }
+    if (!grow_slot(slot, cpct)) {
+        return PM_ERR_NOMEM;
+    }
+    ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+    ZSTD_outBuffer out = {slot -> buf, slot -> cpct, 0};
+    ZSTD_inBuffer in = {src, len, 0};
+    size_t ret = 1;
+    while (ret != 0) {
+        if (out.pos == out.size) {
+            if (!grow_slot(slot, 2 * slot -> cpct)) {
+                return PM_ERR_NOMEM;
+            }
+            out.dst = slot -> buf;
+            out.size = slot -> cpct;
+        }
+        size_t out_pos = out.pos, in_pos = in.pos;
+        ret = ZSTD_decompressStream(dctx, &out, &in);
+        if (ZSTD_isError(ret)
+        || (ret != 0 && out.pos == out_pos && in.pos == in_pos)) {
+            return PM_ERR_FORMAT;       // corrupt or truncated
+        }
+    }
+    slot -> len = out.pos;
+    return PM_OK;
+}
+#endif
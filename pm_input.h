@@ -0,0 +1,46 @@
+/* Compressed input for the process discovery engine.
+
+  A gzip or zstd compressed log is recognised by its magic bytes and handed
+  to the parser as a sequence of decompressed blocks. Decompression runs on
+  threads of its own, a bounded number of blocks ahead of the parser, so
+  reading a compressed log costs little more than decompressing it.
+
+  The compressed bytes are always in memory (a mapped file or a buffer that
+  was read whole), so the frames of a zstd input can be located up front;
+  an input of several frames is decoded one frame per block, frames in
+  parallel, and the blocks are still handed out in input order.
+
+  gzip support is built with -DPM_HAVE_ZLIB (link with -lz) and zstd support
+  with -DPM_HAVE_ZSTD (link with -lzstd); without them such inputs fail with
+  PM_ERR_FORMAT.
+*/
+#ifndef PM_INPUT_H
+#define PM_INPUT_H
+
+#include <stddef.h>
+
+#include "pm_engine.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define INPUT_BLOCK (1 << 20)           // bytes per block of a stream
+#define INPUT_SLOTS 8                   // blocks decoded ahead of the parser
+#define INPUT_THREADS 8                 // most threads decoding zstd frames
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef enum {
+    INPUT_PLAIN = 0,
+    INPUT_GZIP  = 1,
+    INPUT_ZSTD  = 2
+} input_format_t;
+
+typedef struct input input_t;   // the decompressed blocks of an input
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+input_format_t input_format(const char *buf, size_t len);
+pm_status_t    input_open(const char *buf, size_t len, input_t **input);
+pm_status_t    input_next(input_t *input, const char **block, size_t *len);
+void           input_close(input_t *input);
+pm_status_t    input_read_all(const char *buf, size_t len, char **ret,
+                              size_t *ret_len);
+
+#endif
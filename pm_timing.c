@@ -0,0 +1,233 @@
+/* Waiting time aggregation for the process discovery engine, see
+   pm_timing.h.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pm_alloc.h"
+#include "pm_timing.h"
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+static edge_time_t *create_timing(void);
+static void         add_hop(hop_time_t *hop, long count, double sum,
+                            double min, double max);
+static pm_status_t  add_bin(hop_time_t *hop, int bucket, long n);
+static int          sketch_bucket(double x);
+static double       sketch_value(int bucket);
+
+/* Aggregate the waiting times of one trace into the waiting times of its
+   variant. actns and ts are the action and timestamp columns of the trace
+   (NAN when an event has no timestamp), dt and bkt are scratch columns of at
+   least len entries. The waiting times of the variant are created on the
+   first timed handover */
+pm_status_t time_trace(trace_time_t **times, const pm_action_t *actns,
+                       const double *ts, double *dt, int *bkt, int len) {
+    const double *restrict t = ts;
+    double *restrict d = dt;
+    int *restrict k = bkt;
+    int timed = 0;
+
+    // column passes: waiting times, then their buckets
+    for (int i = 0; i < len - 1; i++) {
+        d[i] = t[i + 1] - t[i];
+    }
+    for (int i = 0; i < len - 1; i++) {
+        k[i] = sketch_bucket(d[i]);
+        timed |= (d[i] == d[i]);
+    }
+    if (!timed) {
+        return PM_OK;
+    }
+    if (*times == NULL) {
+        *times = (trace_time_t *)mem_calloc(1, sizeof(trace_time_t)
+                 + sizeof(hop_time_t) * (len - 1));
+        if (*times == NULL) {
+            return PM_ERR_NOMEM;
+        }
+        (*times) -> nhops = len - 1;
+        for (int i = 0; i < len - 1; i++) {
+            (*times) -> hops[i].edge = actns[i] * TIMED_ACTIONS + actns[i + 1];
+        }
+    }
+
+    // scatter into the handovers
+    for (int i = 0; i < len - 1; i++) {
+        if (d[i] != d[i]) {
+            continue;
+        }
+        hop_time_t *hop = (*times) -> hops + i;
+        add_hop(hop, 1, d[i], d[i], d[i]);
+        if (add_bin(hop, k[i], 1) != PM_OK) {
+            return PM_ERR_NOMEM;
+        }
+    }
+    return PM_OK;
+}
+
+/* Merge the waiting times of src into those of the same variant in dst.
+   src is owned by dst afterwards */
+pm_status_t merge_trace_time(trace_time_t **dst, trace_time_t *src) {
+    if (src == NULL) {
+        return PM_OK;
+    }
+    if (*dst == NULL) {
+        *dst = src;
+        return PM_OK;
+    }
+    pm_status_t status = PM_OK;
+    for (int i = 0; i < src -> nhops && status == PM_OK; i++) {
+        hop_time_t *from = src -> hops + i, *to = (*dst) -> hops + i;
+        if (from -> count == 0) {
+            continue;
+        }
+        add_hop(to, from -> count, from -> sum, from -> min, from -> max);
+        for (int j = 0; j < from -> nbins && status == PM_OK; j++) {
+            status = add_bin(to, from -> bins[j].bucket, from -> bins[j].n);
+        }
+    }
+    free_trace_time(src);
+    return status;
+}
+
+/* Add the waiting times of a variant to a timing table, which is created
+   on the first timed handover */
+pm_status_t add_trace_time(edge_time_t **timing, const trace_time_t *times) {
+    if (times == NULL) {
+        return PM_OK;
+    }
+    if (*timing == NULL && (*timing = create_timing()) == NULL) {
+        return PM_ERR_NOMEM;
+    }
+    for (int i = 0; i < times -> nhops; i++) {
+        const hop_time_t *hop = times -> hops + i;
+        edge_time_t *edge = *timing + hop -> edge;
+        if (hop -> count == 0) {
+            continue;
+        }
+        if (edge -> sketch == NULL) {
+            edge -> sketch = (sketch_t *)mem_calloc(1, sizeof(sketch_t));
+            if (edge -> sketch == NULL) {
+                return PM_ERR_NOMEM;
+            }
+            edge -> min = hop -> min;
+            edge -> max = hop -> max;
+        }
+        edge -> count += hop -> count;
+        edge -> sum += hop -> sum;
+        edge -> min = fmin(edge -> min, hop -> min);
+        edge -> max = fmax(edge -> max, hop -> max);
+        for (int j = 0; j < hop -> nbins; j++) {
+            edge -> sketch -> n[hop -> bins[j].bucket] += hop -> bins[j].n;
+        }
+    }
+    return PM_OK;
+}
+
+/* Estimate the q-quantile (0 <= q <= 1) of the waiting times of an edge */
+double sketch_quantile(const edge_time_t *edge, double q) {
+    if (edge -> count == 0) {
+        return NAN;
+    }
+    long rank = (long)ceil(q * edge -> count) - 1;     // nearest rank
+    long seen = 0;
+    int bucket = 0;
+    for (; bucket < SKETCH_BUCKETS - 1; bucket++) {
+        seen += edge -> sketch -> n[bucket];
+        if (seen > rank) {
+            break;
+        }
+    }
+    return fmin(fmax(sketch_value(bucket), edge -> min), edge -> max);
+}
+
+/* Free the waiting times of a variant */
+void free_trace_time(trace_time_t *times) {
+    if (times != NULL) {
+        for (int i = 0; i < times -> nhops; i++) {
+            free(times -> hops[i].bins);
+        }
+        free(times);
+    }
+}
+
+/* Free a timing table */
+void free_timing(edge_time_t *timing) {
+    if (timing != NULL) {
+        for (int i = 0; i < TIMED_ACTIONS * TIMED_ACTIONS; i++) {
+            free(timing[i].sketch);
+        }
+        free(timing);
+    }
+}
+
+/* Create a timing table with no timed edges */
+static edge_time_t *create_timing(void) {
+    return (edge_time_t *)mem_calloc(TIMED_ACTIONS * TIMED_ACTIONS,
+                                 sizeof(edge_time_t));
+}
+
+/* add count waiting times, of the given sum, minimum and maximum, to the
+   totals of a handover */
+static void add_hop(hop_time_t *hop, long count, double sum, double min,
+                    double max) {
+    if (hop -> count == 0) {
+        hop -> min = min;
+        hop -> max = max;
+    }
+    hop -> count += count;
+    hop -> sum += sum;
+    hop -> min = fmin(hop -> min, min);
+    hop -> max = fmax(hop -> max, max);
+}
+
+/* add n waiting times to a sketch bucket of a handover, keeping its buckets
+   ordered */
+static pm_status_t add_bin(hop_time_t *hop, int bucket, long n) {
+    int lo = 0, hi = hop -> nbins;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (hop -> bins[mid].bucket < bucket) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < hop -> nbins && hop -> bins[lo].bucket == bucket) {
+        hop -> bins[lo].n += n;
+        return PM_OK;
+    }
+    if (hop -> nbins == hop -> cpct) {
+        int cpct = 2 * hop -> cpct + 1;
+        bin_t *bins = (bin_t *)mem_realloc(hop -> bins, sizeof(bin_t) * cpct);
+        if (bins == NULL) {
+            return PM_ERR_NOMEM;
+        }
+        hop -> bins = bins;
+        hop -> cpct = cpct;
+    }
+    memmove(hop -> bins + lo + 1, hop -> bins + lo,
+            sizeof(bin_t) * (hop -> nbins - lo));
+    hop -> bins[lo].bucket = bucket;
+    hop -> bins[lo].n = n;
+    hop -> nbins++;
+    return PM_OK;
+}
+
+/* the bucket of a waiting time: bucket 0 holds everything below SKETCH_MIN
+   (and missing values), bucket k covers [MIN * GAMMA^(k-1), MIN * GAMMA^k) */
+static int sketch_bucket(double x) {
+    if (!(x >= SKETCH_MIN)) {
+        return 0;
+    }
+    double k = 1 + floor(log(x / SKETCH_MIN) / log(SKETCH_GAMMA));
+    return (k < SKETCH_BUCKETS - 1) ? (int)k : SKETCH_BUCKETS - 1;
+}
+
+/* the value that represents a bucket, the middle of its bounds */
+static double sketch_value(int bucket) {
+    if (bucket == 0) {
+        return 0;
+    }
+    return SKETCH_MIN * pow(SKETCH_GAMMA, bucket - 1) * (1 + SKETCH_GAMMA) / 2;
+}
@@ -0,0 +1,71 @@
+/* Waiting time aggregation for the process discovery engine.
+
+  For every directly follows edge a -> b between input actions, the engine
+  reports the number of timed handovers, the sum, minimum and maximum of the
+  waiting time between a and b, and a quantile sketch of that waiting time.
+  The sketch is a fixed array of logarithmic buckets (relative error about
+  SKETCH_GAMMA - 1), so two sketches merge by adding their buckets.
+
+  Waiting times are aggregated per input line, from a column of timestamps
+  parallel to the actions, into the distinct trace (variant) of the line:
+  every handover of a variant keeps its own totals and the sketch buckets
+  its waiting times fell in. The timing table of the log is then built from
+  the variants that pass the variant filter, so a dropped variant leaves no
+  waiting times behind.
+*/
+#ifndef PM_TIMING_H
+#define PM_TIMING_H
+
+#include "pm_engine.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define TIMED_ACTIONS 256               // edges are timed between input actions
+#define SKETCH_BUCKETS 512
+#define SKETCH_GAMMA 1.05               // ratio between bucket bounds
+#define SKETCH_MIN 1e-3                 // waiting times below go to bucket 0
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct {                // a mergeable quantile sketch
+    long n[SKETCH_BUCKETS];     // number of waiting times in each bucket
+} sketch_t;
+
+typedef struct {                // the waiting times of one DF edge
+    long      count;            // number of timed handovers
+    double    sum;              // sum of waiting times
+    double    min;              // shortest waiting time
+    double    max;              // longest waiting time
+    sketch_t *sketch;           // distribution, NULL while count is 0
+} edge_time_t;
+
+typedef struct {                // waiting times that fell in one bucket
+    int       bucket;
+    long      n;
+} bin_t;
+
+typedef struct {                // the waiting times of one handover of a
+                                //     variant, the ith to the (i+1)th event
+    int       edge;             // its DF edge, a * TIMED_ACTIONS + b
+    long      count;            // number of timed handovers
+    double    sum;              // sum of waiting times
+    double    min;              // shortest waiting time
+    double    max;              // longest waiting time
+    int       nbins;            // the sketch buckets used ...
+    int       cpct;
+    bin_t    *bins;             // ... ordered by bucket
+} hop_time_t;
+
+typedef struct {                // the waiting times of a variant
+    int        nhops;           // its length - 1
+    hop_time_t hops[];
+} trace_time_t;
+
+/* FUNCTIONS DECLARATION -----------------------------------------------------*/
+pm_status_t time_trace(trace_time_t **times, const pm_action_t *actns,
+                       const double *ts, double *dt, int *bkt, int len);
+pm_status_t merge_trace_time(trace_time_t **dst, trace_time_t *src);
+pm_status_t add_trace_time(edge_time_t **timing, const trace_time_t *times);
+double      sketch_quantile(const edge_time_t *edge, double q);
+void        free_trace_time(trace_time_t *times);
+void        free_timing(edge_time_t *timing);
+
+#endif
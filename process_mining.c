@@ -39,775 +39,455 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
-#include <ctype.h>
-#include <assert.h>
 #include <string.h>
-#include <math.h>
+#include <ctype.h>
+
+#include "pm_engine.h"
+
+/* The discovery itself lives in the engine library (pm_engine.h); this file
+   is the command line front end that reads a log and prints the stages.
+
+   Build: gcc -O2 -o process_mining process_mining.c pm_engine.c \
+              pm_timing.c pm_cache.c pm_input.c pm_alloc.c -lpthread -lm
+          add -DPM_HAVE_ZLIB -lz and -DPM_HAVE_ZSTD -lzstd to read gzip and
+          zstd compressed logs, which are recognised by their content
+
+   Usage: process_mining [options] [log file]  (reads stdin without a file)
+          -t, --timing        print the waiting times of every DF edge
+          -m, --memory        print the heap allocations of discovery
+          --min-activity N    drop actions that occur fewer than N times
+          --min-variant N     drop traces that occur fewer than N times
+          --top-k K           keep the K most frequent actions only
+          --include ACTIONS   keep only the listed actions, e.g. abc
+          --exclude ACTIONS   drop the listed actions
+          --cache DIR         reuse results cached in DIR for unchanged logs
+          --cache-entries N   keep at most N results in the cache
+          --sample N          discover from N traces drawn at random
+          --seed S            seed of the sampling and of the bootstrap
+          --bootstrap B       rate every pattern with B bootstrap replicates
+          --refine R          double the sample up to R times while a
+                              pattern is less stable than --min-stability
+          --min-stability X   the stability refining aims for (0.9)
+
+   Tests: testN-out.txt is the output of process_mining on testN.txt, with
+          the options below for the tests that need them
+          test3               -m --bootstrap 10 --seed 1 (the abstraction
+                              loop makes no heap allocations)
+          test4               -t (waiting times, with an untimed trace
+                              and a date-stamped one)
+          test5               --min-variant 2 --min-activity 3 --exclude e
+                              (filters, with the raw totals)
+          test6               -t --min-variant 2 (no waiting times from
+                              the rare variants)
+          test0.txt.gz is test0.txt compressed with gzip, and gives
+          test0-out.txt when built with -DPM_HAVE_ZLIB -lz
+*/
 
 /* #DEFINE'S -----------------------------------------------------------------*/
-#define MAX_LOG_CAPACITY 1000                  // Maximum event log capacity
-#define CHAR_SEPERATOR ',' 
-#define MAX_LINE_LENGTH 1000
-#define MAX_DISTINCT_ACTION 1000
-#define MAX_DISTINCT_TRACES 1000
-#define MAX_ARRAY_DIMENSION 1024
+#define READ_CHUNK 65536                // bytes read at a time from stdin
+#define MIN_STABILITY 0.9               // default of --min-stability
 
 /* TYPE DEFINITIONS ----------------------------------------------------------*/
-typedef unsigned int action_t;  // an action is identified by an integer
-
-struct pattern {                // a tuple type struct for the seq pantern
-    int a;
-    int b;
-    int type;                   // 0 - SEQ; 1 - CON; 2 - CHC; -1 - ERROR
-};
-
-typedef struct event event_t;   // an event ...
-struct event {                  // ... is composed of ...
-    action_t actn;              // ... an action that triggered it and ...
-    event_t* next;              // ... a pointer to the next event in the trace
-};
-
-typedef struct {                // a trace is a linked list of events
-    event_t* head;              // a pointer to the first event in this trace
-    event_t* foot;              // a pointer to the last event in this trace
-    int      freq;              // the number of times this trace was observed
-} trace_t;
-
-typedef struct {                // an event log is an array of distinct traces
-                                //     sorted lexicographically
-    trace_t* trcs;              // an array of traces
-    int      ndtr;              // the number of distinct traces in this log
-    int      cpct;              // the capacity of this event log as the number
-                                //     of  distinct traces it can hold
-} log_t;
-
-typedef action_t** DF_t;        // a directly follows relation over actions
+typedef struct {                // the command line options
+    const char  *path;          // the log file, NULL for stdin
+    int          timing;        // print the waiting times
+    int          memory;        // print the heap allocations of discovery
+    pm_filter_t  filter;        // the filters applied to the log
+    const char  *cache_dir;     // the result cache, NULL for none
+    long         cache_entries; // the number of cached results kept
+    pm_sample_t  sample;        // approximate discovery on a sample
+    long         refine;        // the number of times the sample may grow
+    double       min_stability; // the stability refining aims for
+} options_t;
 
 /* FUNCTIONS DECLARATION -----------------------------------------------------*/
-event_t *create_event(action_t action);
-event_t *add_to_event(event_t * evnt, action_t action);
-event_t *line_to_event(char *input_line);
-event_t *get_end(event_t *evnt);
-trace_t *create_trace(event_t *event);
-log_t   *create_log();
-log_t   *event_to_log(event_t *event, log_t *log);
-
-struct pattern get_seq_pattern(int **sup_matrix, int **pd_matrix, 
-                               int **w_matrix, action_t *actions, int length);
-
-struct pattern get_pattern(int **sup_matrix, int **pd_matrix, int **w_matrix, 
-                           action_t *actions, int length, int N);
-
-int max(int x, int y);
-int my_getline(char **line, int line_len, FILE *stream);
-int cmp_events(event_t *event1, event_t *event2);
-int get_distinct_event (log_t *log, action_t **ret);
-int in_array(action_t action, action_t *array, int length);
-int get_num_event (log_t *log);
-int get_num_trace (log_t *log);
-int get_num_action (log_t *log, action_t action);
-int get_most_freq_traces (log_t *log, trace_t **most_freq_trace);
-int **create_matrix(action_t *action, int length);
-int cmp_func(const void * a, const void * b);
-int compute_pd(int x, int y);
-int abstract_pattern(log_t *log, struct pattern pattern, int abstraction);
-
-void log_to_sup_matrix (log_t *log, int **matrix, int length);
-void sup_to_pd_matrix (int **sup_matrix, int **pd_matrix, 
-                       action_t *actions, int length);
-void create_w_matrix (int **w_matrix, int **sup_matrix, 
-                      int **pd_matrix, action_t *actions, int length);
-void print_action(action_t action);
-void print_event (event_t *e);
-void print_trace(trace_t *t);
-void print_log(log_t *l);
-void print_matrix(int **matrix, int length, action_t *actions);
-void free_event (event_t *e);
-void free_trace (trace_t *t);
-void free_log (log_t *l);
-void free_trace_array (trace_t *t, int length);
-void free_matrix (int **matrix, int length); 
+int   parse_args(int argc, char *argv[], options_t *opts);
+int   parse_count(const char *arg, long *ret);
+int   is_stable(pm_result_t *result, double min_stability);
+char *read_stream(FILE *stream, size_t *len);
+void print_stats(pm_stats_t *stats);
+void print_result(pm_result_t *result, int approximate);
+void print_timing(pm_timing_t *timing);
+void print_mem(pm_mem_t *mem);
+void print_action(pm_action_t action);
+void print_trace(pm_trace_t *t);
+void print_matrix(long *matrix, int length, pm_action_t *actions);
+int  fail(const char *what, pm_status_t status);
 
 /* WHERE IT ALL HAPPENS ------------------------------------------------------*/
 int main(int argc, char *argv[]) {
-    int line_len = MAX_LINE_LENGTH;
-    char *line = NULL;
-    //create log
-    log_t *log = create_log();
-    
-    // READ INPUT
-    while (my_getline(&line, line_len, stdin) > 0) { 
-        //add line to log
-        event_t *e = line_to_event(line);
-        event_to_log(e, log);
-        free(line);
-    }
+    pm_engine_t *engine = NULL;
+    pm_stats_t stats;
+    pm_result_t result;
+    pm_status_t status;
+    options_t opts;
 
-    // STAGE 0
-    action_t *distinct_events = NULL;
-    trace_t *most_freq_traces = NULL;
-    int num_most_freq_traces = get_most_freq_traces(log, &most_freq_traces);
-    int num_distinct_event = get_distinct_event(log, &distinct_events);
-    printf("==STAGE 0============================\n");
-    printf("Number of distinct events: %d\n", num_distinct_event);
-    printf("Number of distinct traces: %d\n", log -> ndtr);
-    printf("Total number of events: %d\n", get_num_event(log)); 
-    printf("Total number of traces: %d\n", get_num_trace(log));
-    printf("Most frequent trace frequency: %d\n", most_freq_traces[0].freq);
-    for (int i = 0; i < num_most_freq_traces; i++) {
-        print_event(most_freq_traces[i].head);
+    char *buf = NULL;
+    size_t len = 0;
+
+    if (!parse_args(argc, argv, &opts)) {
+        fprintf(stderr, "usage: %s [-t] [-m] [--min-activity N] [--min-variant N]"
+                " [--top-k K] [--include ACTIONS] [--exclude ACTIONS]"
+                " [--cache DIR] [--cache-entries N] [--sample N] [--seed S]"
+                " [--bootstrap B] [--refine R] [--min-stability X]"
+                " [log file]\n", argv[0]);
+        return EXIT_FAILURE;
     }
-    for (int i = 0; i < num_distinct_event; i++) {
-        printf("%c = %d\n", distinct_events[i], 
-        get_num_action(log, distinct_events[i]));
+    if ((status = pm_create(&engine)) != PM_OK) {
+        return fail("create engine", status);
     }
-
-    // STAGE 1
-    printf("==STAGE 1============================\n");
-    int **sup_matrix = NULL;
-    int **pd_matrix = NULL;
-    int **w_matrix = NULL;
-    int num_abstract = 256; 
-    int firsttime = 1;
-
-    while (1) {
-        sup_matrix = create_matrix(distinct_events, num_distinct_event);
-        pd_matrix = create_matrix(distinct_events, num_distinct_event);
-        w_matrix = create_matrix(distinct_events, num_distinct_event);
-        log_to_sup_matrix(log, sup_matrix, MAX_ARRAY_DIMENSION);
-
-        sup_to_pd_matrix(sup_matrix, pd_matrix, 
-                         distinct_events, num_distinct_event);
-        create_w_matrix(w_matrix, sup_matrix, pd_matrix, 
-                        distinct_events, num_distinct_event);
-        struct pattern pattern = get_seq_pattern(sup_matrix, pd_matrix, 
-                            w_matrix, distinct_events, num_distinct_event);
-
-        if (pattern.a < 0) {
-            break;
-        }
-        if (!firsttime) {
-            printf("=====================================\n");
-        }
-        firsttime = 0;
-        print_matrix(sup_matrix, num_distinct_event, distinct_events);
-        printf("-------------------------------------\n");
-        printf("%d = SEQ(", num_abstract);
-        print_action(pattern.a);
-        printf(",");
-        print_action(pattern.b);
-        printf(")\n");
-        printf("Number of events removed: %d\n", 
-                abstract_pattern(log, pattern, num_abstract));
-        free(distinct_events);
-        num_distinct_event = get_distinct_event(log, &distinct_events);
-        for (int i = 0; i < num_distinct_event; i++) {
-            print_action(distinct_events[i]);
-            printf(" = %d\n", get_num_action(log, distinct_events[i]));
-        }
-        num_abstract++;
+    if ((status = pm_set_filter(engine, &opts.filter)) != PM_OK) {
+        pm_free(engine);
+        return fail("set the filters", status);
+    }
+    status = pm_set_cache(engine, opts.cache_dir, opts.cache_entries);
+    if (status != PM_OK) {
+        pm_free(engine);
+        return fail("set the cache", status);
     }
 
-    // STAGE 2
-    printf("==STAGE 2============================\n");
-    firsttime = 1;
+    // READ INPUT AND DISCOVER, ON A GROWING SAMPLE WHEN REFINING
+    if (opts.path == NULL && (buf = read_stream(stdin, &len)) == NULL) {
+        pm_free(engine);
+        return fail("read the log", PM_ERR_IO);
+    }
     while (1) {
-        sup_matrix = create_matrix(distinct_events, num_distinct_event);
-        pd_matrix = create_matrix(distinct_events, num_distinct_event);
-        w_matrix = create_matrix(distinct_events, num_distinct_event);
-        log_to_sup_matrix(log, sup_matrix, MAX_ARRAY_DIMENSION);
-
-        sup_to_pd_matrix(sup_matrix, pd_matrix, 
-                         distinct_events, num_distinct_event);
-        create_w_matrix(w_matrix, sup_matrix, pd_matrix, 
-                        distinct_events, num_distinct_event);
-        
-        int N = get_num_event(log);
-        struct pattern pattern = get_pattern(sup_matrix, pd_matrix, 
-        w_matrix, distinct_events, num_distinct_event, N);
-
-        if (pattern.a < 0) {
+        if ((status = pm_set_sample(engine, &opts.sample)) != PM_OK) {
             break;
         }
-        if (!firsttime) {
-            printf("=====================================\n");
+        if (opts.path != NULL) {
+            status = pm_load_log_file(engine, opts.path);
+        } else {
+            status = pm_load_log(engine, buf, len);
         }
-        firsttime = 0;
-        print_matrix(sup_matrix, num_distinct_event, distinct_events);
-        printf("-------------------------------------\n");
-        
-        if (pattern.type == 0) {
-            printf("%d = SEQ(", num_abstract); 
+        if (status != PM_OK) {
+            free(buf);
+            pm_free(engine);
+            return fail("read the log", status);
         }
-        if (pattern.type == 1) {
-            printf("%d = CON(", num_abstract);
+        if ((status = pm_discover(engine, &result)) != PM_OK) {
+            break;
         }
-        if (pattern.type == 2) {
-            printf("%d = CHC(", num_abstract);
+        if ((status = pm_stats(engine, &stats)) != PM_OK) {
+            pm_result_release(&result);
+            break;
         }
-
-        print_action(pattern.a);
-        printf(",");
-        print_action(pattern.b);
-        printf(")\n");
-
-        printf("Number of events removed: %d\n", 
-                abstract_pattern(log, pattern, num_abstract));
-        free(distinct_events);
-        num_distinct_event = get_distinct_event(log, &distinct_events);
-        for (int i = 0; i < num_distinct_event; i++) {
-            print_action(distinct_events[i]);
-            printf(" = %d\n", get_num_action(log, distinct_events[i]));
+        if (opts.refine-- <= 0 || stats.sample_ntraces == 0
+        || stats.sample_ntraces >= stats.input_ntraces
+        || is_stable(&result, opts.min_stability)) {
+            break;
         }
-        num_abstract++;
-    }
-    printf("==THE END============================\n");
-
-    // FREE EVERYTHING
-    free_matrix(sup_matrix, num_distinct_event);
-    free_matrix(pd_matrix, num_distinct_event);
-    free_matrix(w_matrix, num_distinct_event);
-    free_log(log);
-    free(distinct_events);
-    for (int i = 0; i < num_most_freq_traces;i++) {
-        free_event((most_freq_traces[i]).head);
-    }
-    free(most_freq_traces);
-    return EXIT_SUCCESS;       
-}
-
-/* Create an event of length 1. Put an action inside an event */
-event_t *create_event(action_t action) {
-    event_t *ret = (event_t *)malloc(sizeof(event_t));
-    if (ret == NULL) {
-        printf("Creat_event_error");
-        return NULL;
-    }
-    ret -> actn = action;
-    ret -> next = NULL;
-    return ret;
-}
-
-/* Adds an action to the end of an event */
-event_t *add_to_event(event_t * evnt, action_t action) {
-    if (evnt == NULL) {
-        return create_event(action);
+        pm_result_release(&result);
+        pm_stats_release(&stats);
+        opts.sample.size *= 2;
     }
-    while (evnt -> next != NULL) {
-        evnt = evnt -> next;
+    free(buf);
+    if (status != PM_OK) {
+        pm_free(engine);
+        return fail("discover the process model", status);
     }
-    evnt -> next = create_event(action);
-    return evnt -> next;
-}
-
-/* Converting an input line into an event */ 
-event_t *line_to_event(char *input_line) {
-    int i;
-    event_t *event;
-
-    if (strlen(input_line) <= 0) {
-        return NULL;
-    }
-
-    event = create_event(input_line[0]);
 
-    for (i = 1; i < strlen(input_line); i++) {
-        if (input_line[i - 1] == CHAR_SEPERATOR) {
-            add_to_event(event,input_line[i]);
+    // STAGE 0
+    print_stats(&stats);
+    pm_stats_release(&stats);
+    if (opts.timing) {
+        pm_timing_t times;
+        if ((status = pm_timing(engine, &times)) != PM_OK) {
+            pm_free(engine);
+            return fail("summarise the waiting times", status);
         }
+        print_timing(&times);
+        pm_timing_release(&times);
+    }
+    if (opts.memory) {
+        pm_mem_t mem;
+        if ((status = pm_mem_stats(engine, &mem)) != PM_OK) {
+            pm_free(engine);
+            return fail("read the memory use", status);
+        }
+        print_mem(&mem);
     }
-    return event;
-}
-
-/* Create a trace from an event*/
-trace_t *create_trace(event_t *event) {
-    trace_t *ret = (trace_t *)malloc(sizeof(trace_t));
-     if (ret == NULL) {
-        printf("Creat_trace_error");
-        return NULL;
-    }
-    ret -> freq = 1;
-    ret -> head = event;
-    ret -> foot = get_end(event);
-
-    return ret;
-}
-
-/* Create an empty log to append event */
-log_t *create_log() {
-    log_t *ret = (log_t *)malloc(sizeof(log_t));
-     if (ret == NULL) {
-        printf("Creat_log_error");
-        return NULL;
-    }
-    ret -> ndtr = 0;
-    ret -> cpct = MAX_LOG_CAPACITY;
-    ret -> trcs = (trace_t *)malloc(sizeof(trace_t) * ret -> cpct);
-    assert((ret -> trcs) != NULL);
 
-    return ret;
-}
+    // STAGE 1 AND 2
+    print_result(&result, opts.sample.size > 0 || opts.sample.bootstrap > 0);
+    pm_result_release(&result);
 
-/* Add event to the log */
-log_t *event_to_log(event_t *event, log_t *log) {
-    int i;
-    for (i = 0; i < (log -> ndtr); i++) {
-        trace_t *trace = log -> trcs + i;
-        if (cmp_events(event, trace -> head) == 0) {
-            (trace -> freq)++;
-            return log;
+    // FREE EVERYTHING
+    pm_free(engine);
+    return EXIT_SUCCESS;
+}
+
+/* Read the command line options, returns 0 if they are malformed */
+int parse_args(int argc, char *argv[], options_t *opts) {
+    long k = 0;
+    char *end;
+    memset(opts, 0, sizeof(options_t));
+    opts -> min_stability = MIN_STABILITY;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-t") == 0 || strcmp(arg, "--timing") == 0) {
+            opts -> timing = 1;
+            continue;
         }
-        if (cmp_events(event, trace -> head) == 1) {
-            for(int j = (log -> ndtr) - 1; j >= i; j--) {
-                (log -> trcs)[j + 1] = (log -> trcs)[j];
-            }
-
-            trace_t *t = create_trace(event);
-            (log -> trcs)[i] = *t;
-            free(t);
-            log -> ndtr += 1;
-            return log;
+        if (strcmp(arg, "-m") == 0 || strcmp(arg, "--memory") == 0) {
+            opts -> memory = 1;
+            continue;
         }
-    }
-    trace_t *t  = create_trace(event);
-    (log -> trcs)[(log -> ndtr)] = *t;
-    log -> ndtr++;
-    free(t);
-    return log;
-}
-
-/* get the final action in a given event*/
-event_t *get_end(event_t *evnt) {
-    if (evnt == NULL) {
-        return NULL;
-    }
-    while (evnt -> next != NULL) {
-        evnt = evnt -> next;
-    }
-    return evnt;
-}
-
-/* get the SEQ pattern from the matrix*/
-struct pattern get_seq_pattern(int **sup_matrix, int **pd_matrix, 
-int **w_matrix, action_t *actions, int length) {
-    int max_w = 0;
-    struct pattern ret = {-1, -1, 0};
-    for (int i = 0; i < length; i++) {
-        action_t x = actions[i];
-        for (int j = 0; j < length; j++) {
-            action_t y = actions[j];
-            if (x == y) {
-                continue;
-            }
-            if (pd_matrix[x][y] <= 70) {
-                continue;
-            }
-            if (x >= 256 || y >= 256) {
-                continue;
-            }
-            if (w_matrix[x][y] > max_w) {
-                max_w = w_matrix[x][y];
-                ret.a = x; 
-                ret.b = y;
+        if (arg[0] != '-') {
+            if (opts -> path != NULL) {
+                return 0;
             }
+            opts -> path = arg;
+            continue;
         }
-    }
-    return ret;
-}
-
-/* get the pattern(SEQ, CON or CHC) from the matrix */
-struct pattern get_pattern(int **sup_matrix, int **pd_matrix, 
-int **w_matrix, action_t *actions, int length, int N) {
-    int max_w = 0;
-    struct pattern ret = {-1, -1, -1};
-    for (int i = 0; i < length; i++) {
-        action_t x = actions[i];
-        for (int j = 0; j < length; j++) {
-            int pat = -1;
-            int w = 0;
-            action_t y = actions[j];
-            if (x == y) {
-                continue;
+        // every other option takes a value
+        if (val == NULL) {
+            return 0;
+        }
+        i++;
+        if (strcmp(arg, "--min-activity") == 0) {
+            if (!parse_count(val, &opts -> filter.min_activity_freq)) {
+                return 0;
             }
-            if (max(sup_matrix[x][y], sup_matrix[y][x]) <= N/100) {
-                pat = 2;  
-                w = N * 100;
+        } else if (strcmp(arg, "--min-variant") == 0) {
+            if (!parse_count(val, &opts -> filter.min_variant_freq)) {
+                return 0;
             }
-            else if (pd_matrix[x][y] < 30){
-                pat = 1;
-                w =  w_matrix[x][y];
-                if (!(x >= 256 || y >= 256)) {
-                    w = w * 100;
-                }
+        } else if (strcmp(arg, "--top-k") == 0) {
+            if (!parse_count(val, &k) || k > 256) {
+                return 0;
             }
-            else if (pd_matrix[x][y] > 70) {
-                pat = 0;
-                w =  w_matrix[x][y];
-                if (!(x >= 256 || y >= 256)) {
-                    w = w * 100;
-                }
+            opts -> filter.top_k = k;
+        } else if (strcmp(arg, "--include") == 0) {
+            opts -> filter.include = val;
+        } else if (strcmp(arg, "--exclude") == 0) {
+            opts -> filter.exclude = val;
+        } else if (strcmp(arg, "--cache") == 0) {
+            opts -> cache_dir = val;
+        } else if (strcmp(arg, "--cache-entries") == 0) {
+            if (!parse_count(val, &opts -> cache_entries)
+            || opts -> cache_entries > 1 << 20) {
+                return 0;
             }
-            if (pat == -1){
-                continue;
+        } else if (strcmp(arg, "--sample") == 0) {
+            if (!parse_count(val, &opts -> sample.size)) {
+                return 0;
             }
-            if (w > max_w) {
-                max_w = w;
-                ret.a = x; 
-                ret.b = y;
-                ret.type = pat;
+        } else if (strcmp(arg, "--seed") == 0) {
+            if (!parse_count(val, &k)) {
+                return 0;
             }
-        }
-    }
-    return ret;
-}
-
-/* abstract the given pattern in to a number */
-int abstract_pattern(log_t *log, struct pattern pattern, int abstraction) {
-    int num_removed = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        event_t *current = (log -> trcs + i) -> head;
-        while (current != NULL) {
-            if ((current -> actn == pattern.a) 
-            || (current -> actn == pattern.b)) {
-                current -> actn = abstraction;
+            opts -> sample.seed = k;
+        } else if (strcmp(arg, "--bootstrap") == 0) {
+            if (!parse_count(val, &k) || k > 100000) {
+                return 0;
             }
-            current = current -> next;
-        } 
-    }
-    for (int i = 0; i < log -> ndtr; i++) {
-        event_t *current = (log -> trcs + i) -> head;
-        while (current -> next != NULL) {
-            if ((current -> actn == abstraction) 
-            && (current -> next -> actn == abstraction)) {
-                event_t *nextnext = current -> next -> next;
-                free(current -> next);
-                current -> next = nextnext;
-                num_removed += (log -> trcs + i) -> freq;
-            } else{
-                current = current -> next;
+            opts -> sample.bootstrap = k;
+        } else if (strcmp(arg, "--refine") == 0) {
+            if (!parse_count(val, &opts -> refine)) {
+                return 0;
             }
-        } 
-    }
-    return num_removed;
-}
-
-/* Read in input from the command prompt*/
-int my_getline(char **line, int line_len, FILE *stream) {
-    char c = 0;
-    int length = 0;
-    (*line) = (char*)malloc(sizeof(char) * line_len);
-    assert((*line) != NULL);
-    while ((c = getc(stream)) != '\n') {
-        if (c == EOF) {
-            return length;
-        }
-        (*line)[length] = c;
-        (*line)[length + 1] = 0;
-        length++;
-    }
-    return length;
-}
-
-/* compare two event in ASCII code*/
-int cmp_events(event_t *event1, event_t *event2) {
-    while ((event1 != NULL) && (event2 != NULL)) {
-        // if event1 < event 2 (ASCII)
-        if (event1 -> actn > event2 -> actn) {
-            return -1;
-        }
-        // if event 2 > event 1 (ASCII)
-        if (event1 -> actn < event2 -> actn) {
-            return 1;
-        }
-        // if event 1 == event 2 (ASCII), move it to the next event
-        event1 = event1 -> next;
-        event2 = event2 -> next;
-    }
-    if ((event1 == NULL) && (event2 != NULL)) {
-        return -1;
-    }
-    if ((event1 != NULL) && (event2 == NULL)) {
-        return 1;
-    }
-    return 0;
-}
-
-/* compare function use for call qsort */
-int cmp_func(const void * a, const void * b) {
-    return (*(int*)a - *(int*)b);
-}
-
-/* get the number of distinct event */
-int get_distinct_event (log_t *log, action_t **ret) {
-    (*ret) = (action_t *)malloc(sizeof(action_t) * MAX_DISTINCT_ACTION);
-    assert((*ret) != NULL);
-    int length = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        event_t *current = (log -> trcs + i) -> head;
-        while (current != NULL) {
-            if (!in_array(current -> actn, (*ret), length)){
-                (*ret)[length] = current -> actn;
-                length++;
+        } else if (strcmp(arg, "--min-stability") == 0) {
+            opts -> min_stability = strtod(val, &end);
+            if (*val == 0 || *end != 0) {
+                return 0;
             }
-            current = current -> next;
-        }
-    }
-    qsort(*ret, length, sizeof(action_t), cmp_func);
-    return length;
-}
-
-/* get the total number of event */
-int get_num_event (log_t *log) {
-    int count_event = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        int c = 0;
-        event_t *current = (log -> trcs + i) -> head;
-        while (current != NULL) {
-            c++;
-            current = current -> next;
+        } else {
+            return 0;
         }
-        count_event += (c * ((log -> trcs + i) -> freq));
     }
-    return count_event;
+    return 1;
 }
 
-/* get the total number of traces */
-int get_num_trace (log_t *log) {
-    int count_trace = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        count_trace += (log -> trcs)[i].freq;
-    }
-    return count_trace;
+/* Read a non-negative number, returns 0 if it is malformed */
+int parse_count(const char *arg, long *ret) {
+    char *end;
+    *ret = strtol(arg, &end, 10);
+    return *arg != 0 && *end == 0 && *ret >= 0;
 }
 
-/* get the most frequent traces */
-int get_most_freq_traces (log_t *log, trace_t **most_freq_trace) {
-    (*most_freq_trace) = (trace_t *)malloc(sizeof(trace_t) 
-    * MAX_DISTINCT_TRACES);
-    assert((*most_freq_trace) != NULL);
-    int length = 0;
-    int most_freq = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        if (most_freq == (log -> trcs)[i].freq) {
-            length += 1;
-            (*most_freq_trace)[length - 1] = (log -> trcs)[i];
-        }
-        if (most_freq < (log -> trcs)[i].freq) {
-            length = 1;
-            (*most_freq_trace)[0] = (log -> trcs)[i];
-            most_freq = (log -> trcs)[i].freq;
+/* Whether every pattern of a model is at least min_stability stable, by
+   its bootstrap support when there is one and by its margin otherwise */
+int is_stable(pm_result_t *result, double min_stability) {
+    for (int i = 0; i < result -> nsteps; i++) {
+        pm_step_t *step = result -> steps + i;
+        double stability = (step -> support >= 0) ? step -> support
+                                                  : step -> margin;
+        if (stability < min_stability) {
+            return 0;
         }
     }
-    return length;
+    return 1;
 }
 
-/* get the total number of actions */
-int get_num_action (log_t *log, action_t action) {
-    int count_action = 0;
-    for (int i = 0; i < log -> ndtr; i++) {
-        int c = 0;
-        event_t *current = (log -> trcs + i) -> head;
-        while (current != NULL) {
-            if (current -> actn == action) {
-                c++; 
-            }
-            current = current -> next;
+/* Read a whole stream into memory */
+char *read_stream(FILE *stream, size_t *len) {
+    size_t cpct = READ_CHUNK;
+    char *buf = (char *)malloc(cpct);
+    *len = 0;
+    while (buf != NULL) {
+        *len += fread(buf + *len, 1, cpct - *len, stream);
+        if (*len < cpct) {
+            break;
         }
-        count_action += (c * ((log -> trcs + i) -> freq));
-    }
-    return count_action;
-}
-
-/* check if the current action is in the array */
-int in_array(action_t action, action_t *array, int length) {
-    for (int i = 0; i < length; i++) {
-        if (array[i] == action) {
-            return 1;
-        }  
+        cpct *= 2;
+        char *grown = (char *)realloc(buf, cpct);
+        if (grown == NULL) {
+            free(buf);
+            return NULL;
+        }
+        buf = grown;
     }
-    return 0;
-}
-
-/* create an empty matrix */
-int **create_matrix(action_t *action, int length) {
-    int **ret = (int **)malloc(sizeof(int*) * MAX_ARRAY_DIMENSION);
-    assert(ret != NULL);
-    for (int i = 0; i < length; i++) {
-        ret[action[i]] = (int *)malloc(sizeof(int) * MAX_ARRAY_DIMENSION);
-        assert((ret[action[i]]) != NULL);
+    if (buf != NULL && ferror(stream)) {
+        free(buf);
+        return NULL;
     }
-    return ret;
+    return buf;
 }
 
-/* create the sup matrix for a given log */
-void log_to_sup_matrix (log_t *log, int **matrix, int length) {
-    for (int i = 0; i < log -> ndtr; i++) {
-        event_t *current = (log -> trcs + i) -> head;
-        while (current != NULL) {
-            if (current -> next != NULL) {
-                matrix[current -> actn][(current -> next) -> actn] 
-                += (((log -> trcs) + i) -> freq);
-            }
-            current = current -> next;
+/* print out the Stage 0 numbers */
+void print_stats(pm_stats_t *stats) {
+    printf("==STAGE 0============================\n");
+    printf("Number of distinct events: %d\n", stats -> ndistinct_events);
+    printf("Number of distinct traces: %d\n", stats -> ndistinct_traces);
+    printf("Total number of events: %ld\n", stats -> nevents);
+    printf("Total number of traces: %ld\n", stats -> ntraces);
+    if (stats -> sample_ntraces > 0) {
+        printf("Sampled traces: %ld of %ld\n", stats -> sample_ntraces,
+               stats -> input_ntraces);
+    }
+    if (stats -> filtered) {
+        printf("Raw number of distinct events: %d\n",
+               stats -> raw_ndistinct_events);
+        printf("Raw number of events: %ld\n", stats -> raw_nevents);
+        printf("Raw number of traces: %ld\n", stats -> raw_ntraces);
+    }
+    printf("Most frequent trace frequency: %ld\n", stats -> most_freq);
+    for (int i = 0; i < stats -> nmost_freq; i++) {
+        print_trace(stats -> most_freq_traces + i);
+    }
+    for (int i = 0; i < stats -> ndistinct_events; i++) {
+        printf("%c = %ld\n", stats -> actions[i], stats -> action_counts[i]);
+    }
+}
+
+/* print out the waiting times of the timed DF edges */
+void print_timing(pm_timing_t *timing) {
+    printf("==WAITING TIMES======================\n");
+    for (int i = 0; i < timing -> nedges; i++) {
+        pm_edge_time_t *edge = timing -> edges + i;
+        print_action(edge -> a);
+        printf(" -> ");
+        print_action(edge -> b);
+        printf(": n = %ld, mean = %.2f, min = %.2f, max = %.2f, "
+               "p50 = %.2f, p90 = %.2f, p99 = %.2f\n", edge -> count,
+               edge -> sum / edge -> count, edge -> min, edge -> max,
+               edge -> p50, edge -> p90, edge -> p99);
+    }
+}
+
+/* print out the Stage 1 and Stage 2 abstraction steps, and how stable their
+   patterns are when the model is approximate */
+void print_result(pm_result_t *result, int approximate) {
+    static const char *names[] = {"SEQ", "CON", "CHC"};
+    int stage = 0;
+    printf("==STAGE 1============================\n");
+    for (int i = 0; i < result -> nsteps; i++) {
+        pm_step_t *step = result -> steps + i;
+        if (step -> stage != stage && step -> stage == 2) {
+            printf("==STAGE 2============================\n");
+        } else if (step -> stage == stage) {
+            printf("=====================================\n");
         }
-    }
-}
-
-/* transform the sup matrix into pd matrix */
-void sup_to_pd_matrix (int **sup_matrix, int **pd_matrix, 
-action_t *actions, int length) {
-    for (int i = 0; i < length; i++) {
-        action_t x = actions[i];
-        for (int j = 0; j < length; j++) {
-            action_t y = actions[j];
-            if ((x != y) && (sup_matrix[x][y] > sup_matrix[y][x])) {
-                pd_matrix[x][y] = compute_pd(sup_matrix[x][y], 
-                sup_matrix[y][x]); 
+        stage = step -> stage;
+        print_matrix(step -> sup, step -> nacts, step -> acts);
+        printf("-------------------------------------\n");
+        printf("%d = %s(", step -> id, names[step -> type]);
+        print_action(step -> a);
+        printf(",");
+        print_action(step -> b);
+        printf(")\n");
+        printf("Number of events removed: %ld\n", step -> removed);
+        if (approximate) {
+            printf("Stability: margin = %.2f", step -> margin);
+            if (step -> support >= 0) {
+                printf(", bootstrap = %.2f", step -> support);
             }
-            else {
-                pd_matrix[x][y] = 0;
-            } 
+            printf("\n");
         }
-    }
-}
-
-/* create the weight matrix from sup and pd matrix */
-void create_w_matrix (int **w_matrix, int **sup_matrix, 
-int **pd_matrix, action_t *actions, int length) {
-    for (int i = 0; i < length; i++) {
-        action_t x = actions[i];
-        for (int j = 0; j < length; j++) {
-            action_t y = actions[j];
-            w_matrix[x][y] = abs(50 - pd_matrix[x][y]) 
-            * max(sup_matrix[x][y], sup_matrix[y][x]);
+        for (int j = 0; j < step -> nafter; j++) {
+            print_action(step -> after_acts[j]);
+            printf(" = %ld\n", step -> after_counts[j]);
         }
     }
-}
-
-/* calculate the pd value for a pair of action */
-int compute_pd(int x, int y) {
-    return (100 * abs(x - y))/(max(x, y)); 
-}
-
-/* find the maximum number out of two number */
-int max(int x, int y) {
-    if (x > y) {
-        return x;
+    if (stage < 2) {
+        printf("==STAGE 2============================\n");
     }
-    return y;
+    printf("==THE END============================\n");
 }
 
 /* print out the matrix */
-void print_matrix(int **matrix, int length, action_t *actions) {
+void print_matrix(long *matrix, int length, pm_action_t *actions) {
     // print header
     printf("     ");
     for (int i = 0; i < length; i++) {
-        if (isalpha(actions[i])) {
+        if (actions[i] < 256 && isalpha(actions[i])) {
             printf("%*c", 5, actions[i]);
         }
         else {
             printf("%*d", 5, actions[i]);
-        }   
+        }
     }
     printf("\n");
     // print the matrix content
     for (int i = 0; i < length; i++) {
-        if (isalpha(actions[i])) {
+        if (actions[i] < 256 && isalpha(actions[i])) {
             printf("%*c", 5, actions[i]);
         }
         else {
             printf("%*d", 5, actions[i]);
-        }   
+        }
         for (int j = 0; j < length; j++) {
-            printf("%*d", 5, matrix[actions[i]][actions[j]]);
+            printf("%*ld", 5, matrix[i * length + j]);
         }
         printf("\n");
     }
 }
 
-/* print out the action */
-void print_action(action_t action) {
-    if (isalpha(action)) {
-            printf("%c",action);
-        }
-        else {
-            printf("%d", action);
-        }
-}
-
-/* print out the event */
-void print_event (event_t *e) {
-    while (e != NULL) {
-        print_action(e -> actn);
-        e = e->next;
-    }
-    printf("\n");
-}
-
-/* print out the trace */
-void print_trace(trace_t *t) {
-    printf("head: ");
-    print_event(t -> head);
-    printf("foot: ");
-    print_event(get_end(t -> head)); 
-    printf("freq: ");
-    printf("%d\n", t -> freq);
-}
-
-/* print out the log */
-void print_log(log_t *l) {
-    int i;
-    printf("\n---printing log---\n");
-    for (i = 0; i < l -> ndtr; i++) {
-        printf("\ntrace %d: \n",i);
-        print_trace((l -> trcs) + i);
-    }
-    printf("length = %d\n", l -> ndtr);
+/* print out the heap allocations of discovery, per phase */
+void print_mem(pm_mem_t *mem) {
+    printf("==MEMORY=============================\n");
+    printf("Discoveries: %ld\n", mem -> discoveries);
+    printf("Setup allocations: %ld\n", mem -> setup_allocs);
+    printf("Loop allocations: %ld\n", mem -> loop_allocs);
+    printf("Result allocations: %ld\n", mem -> result_allocs);
 }
 
-/* Free the memory allocated for the event */
-void free_event (event_t *e) {
-    if (e != NULL) {
-        free_event(e -> next);
-        free(e);
-    }
-}
-
-/* Free the memory allocated for the trace*/
-void free_trace (trace_t *t) {
-    if (t != NULL) {
-        free_event(t -> head);
-        free(t);
+/* print out the action */
+void print_action(pm_action_t action) {
+    if (action < 256 && isalpha(action)) {
+        printf("%c", action);
     }
-}
-
-/* Free the memory allocated for the log */
-void free_log (log_t *l) {
-    if (l != NULL) {
-        free_trace_array(l -> trcs, l -> ndtr);
-        free(l);
+    else {
+        printf("%d", action);
     }
 }
 
-/* Free each trace in the log struct */
-void free_trace_array (trace_t *t, int length) {
-    int i;
-    for (i = 0; i < length; i++) {
-    free_event(t[i].head);
+/* print out the actions of a trace */
+void print_trace(pm_trace_t *t) {
+    for (int i = 0; i < t -> len; i++) {
+        print_action(t -> actns[i]);
     }
-    free(t);
+    printf("\n");
 }
 
-/* free memory allocated for the matrix */
-void free_matrix (int **matrix, int length) {
-    if (matrix != NULL) {
-        for (int i = 0; i < length; i++) {
-            if (matrix[i] != NULL) {
-                free(matrix[i]);
-            }
-        }
-        free(matrix);
-    }
+/* report an engine error */
+int fail(const char *what, pm_status_t status) {
+    fflush(stdout);
+    fprintf(stderr, "process_mining: could not %s: %s\n", what,
+            pm_strerror(status));
+    return EXIT_FAILURE;
 }
 
-/* algorithms are fun */
\ No newline at end of file
+/* algorithms are fun */